@@ -1,2 +1,23 @@
 COMPONENT_INCDIRS = src/include
 COMPONENT_SRCDIRS = src
+
+# Number of distinct character styles which may be on screen at once when using the cell grid
+COMPONENT_VARS += VT100_MAX_STYLES
+VT100_MAX_STYLES ?= 32
+GLOBAL_CFLAGS += -DVT100_MAX_STYLES=$(VT100_MAX_STYLES)
+
+# Number of distinct non-ASCII characters which may be on screen at once when using the cell grid (1-128)
+COMPONENT_VARS += VT100_MAX_CHARS
+VT100_MAX_CHARS ?= 128
+GLOBAL_CFLAGS += -DVT100_MAX_CHARS=$(VT100_MAX_CHARS)
+
+# Set to 1 to keep counters of parser activity and display calls, see Terminal::getStats()
+COMPONENT_VARS += VT100_ENABLE_STATS
+VT100_ENABLE_STATS ?= 0
+GLOBAL_CFLAGS += -DVT100_ENABLE_STATS=$(VT100_ENABLE_STATS)
+
+# Multi-session manager, thread pool and file access, for the Host emulator only
+ifeq ($(SMING_ARCH),Host)
+COMPONENT_SRCDIRS += src/Host
+EXTRA_LDFLAGS += -pthread
+endif
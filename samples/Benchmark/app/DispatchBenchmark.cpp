@@ -0,0 +1,180 @@
+#include <SmingCore.h>
+#include <VT100/DisplayAdapter.h>
+#include "benchmark.h"
+
+namespace
+{
+#ifdef ARCH_HOST
+const unsigned frameCount = 20000;
+#else
+const unsigned frameCount = 50;
+#endif
+
+const uint16_t cols = 80;
+const uint16_t rows = 24;
+
+/*
+ * Backend standing in for a display controller: each call does a little work,
+ * like queueing a command, so the cost of reaching it dominates
+ */
+class ChecksumBackend
+{
+public:
+	void drawChar(uint16_t x, uint16_t y, uint8_t c)
+	{
+		mix((uint32_t(x) << 16) | y);
+		mix(c);
+	}
+
+	void setFrontColor(uint16_t col)
+	{
+		mix(col);
+	}
+
+	void setBackColor(uint16_t col)
+	{
+		mix(col);
+	}
+
+	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+	{
+		mix(x + y + w + h + color);
+	}
+
+	void scroll(uint16_t top, uint16_t bottom, int16_t diff)
+	{
+		mix(top + bottom + diff);
+	}
+
+	uint16_t getWidth()
+	{
+		return cols * 8;
+	}
+
+	uint16_t getHeight()
+	{
+		return rows * 8;
+	}
+
+	uint8_t getCharWidth()
+	{
+		return 8;
+	}
+
+	uint8_t getCharHeight()
+	{
+		return 8;
+	}
+
+	uint32_t getChecksum() const
+	{
+		return checksum;
+	}
+
+private:
+	void mix(uint32_t value)
+	{
+		checksum = (checksum ^ value) * 16777619U;
+	}
+
+	uint32_t checksum{2166136261U};
+};
+
+/*
+ * The same backend behind virtual methods, using the default Display::drawCells()
+ */
+class VirtualDisplay : public VT100::Display
+{
+public:
+	void drawString(uint16_t x, uint16_t y, const char* text) override
+	{
+		for(; *text != '\0'; ++text, x += 8) {
+			backend.drawChar(x, y, *text);
+		}
+	}
+
+	void drawChar(uint16_t x, uint16_t y, uint8_t c) override
+	{
+		backend.drawChar(x, y, c);
+	}
+
+	void setBackColor(uint16_t col) override
+	{
+		backend.setBackColor(col);
+	}
+
+	void setFrontColor(uint16_t col) override
+	{
+		backend.setFrontColor(col);
+	}
+
+	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) override
+	{
+		backend.fillRect(x, y, w, h, color);
+	}
+
+	void scroll(uint16_t top, uint16_t bottom, int16_t diff) override
+	{
+		backend.scroll(top, bottom, diff);
+	}
+
+	uint16_t getWidth() override
+	{
+		return backend.getWidth();
+	}
+
+	uint16_t getHeight() override
+	{
+		return backend.getHeight();
+	}
+
+	uint8_t getCharWidth() override
+	{
+		return backend.getCharWidth();
+	}
+
+	uint8_t getCharHeight() override
+	{
+		return backend.getCharHeight();
+	}
+
+	ChecksumBackend backend;
+};
+
+uint8_t chars[cols];
+VT100::CellAttr attrs[cols];
+
+// Redraw every row as the cell grid would after a full-screen change
+void run(const char* name, VT100::Display& display, const ChecksumBackend& backend)
+{
+	auto start = micros();
+	for(unsigned frame = 0; frame < frameCount; ++frame) {
+		for(uint16_t row = 0; row < rows; ++row) {
+			display.drawCells(0, row * 8, chars, attrs, cols);
+		}
+	}
+	auto elapsed = micros() - start;
+
+	unsigned psPerCell = elapsed * 1000000ULL / (uint64_t(frameCount) * rows * cols);
+	Serial.printf(_F("  %-8s %u.%03u ns/cell (checksum %08x)\r\n"), name, psPerCell / 1000, psPerCell % 1000,
+				  backend.getChecksum());
+}
+
+} // namespace
+
+void benchmarkDispatch()
+{
+	Serial.printf(_F("\r\nDisplay dispatch, %u frames of %u x %u\r\n"), frameCount, cols, rows);
+
+	// Colour changes every few characters, as in coloured listings
+	for(unsigned i = 0; i < cols; ++i) {
+		chars[i] = 0x20 + (i % 95);
+		attrs[i] = {uint16_t(((i / 6) & 1) ? 0xf800 : 0xffff), 0x0000};
+	}
+
+	VirtualDisplay virtualDisplay;
+	run("virtual", virtualDisplay, virtualDisplay.backend);
+
+	VT100::DisplayAdapter<ChecksumBackend> adapter;
+	run("adapter", adapter, adapter);
+}
@@ -0,0 +1,77 @@
+#include <SmingCore.h>
+#include <new>
+#include <VT100/FrameBufferDisplay.h>
+#include "benchmark.h"
+
+namespace
+{
+#ifdef ARCH_HOST
+const unsigned glyphCount = 2000000;
+const size_t cacheBudget = 128 * 1024;
+#else
+const unsigned glyphCount = 20000;
+const size_t cacheBudget = 8 * 1024;
+#endif
+
+// Small framebuffer which fits on devices, 40 x 4 characters
+const uint16_t width = 320;
+const uint16_t height = 32;
+
+// A handful of colour pairs, as typical terminal output uses
+const VT100::CellAttr colors[] = {
+	{0xffff, 0x0000},
+	{0xf800, 0x0000},
+	{0x07e0, 0x0000},
+	{0x0000, 0xffff},
+};
+
+void run(const char* name, VT100::FrameBufferDisplay& display)
+{
+	const unsigned cols = width / display.getCharWidth();
+	const unsigned rows = height / display.getCharHeight();
+
+	auto start = micros();
+	for(unsigned i = 0; i < glyphCount; ++i) {
+		auto& attr = colors[(i / 7) % 4];
+		display.setFrontColor(attr.frontColor);
+		display.setBackColor(attr.backColor);
+		unsigned cell = i % (cols * rows);
+		display.drawChar((cell % cols) * display.getCharWidth(), (cell / cols) * display.getCharHeight(),
+						 0x20 + (i % 95));
+	}
+	auto elapsed = micros() - start;
+
+	unsigned psPerGlyph = elapsed * 1000000ULL / glyphCount;
+	auto& cache = display.getGlyphCache();
+	Serial.printf(_F("  %s: %u.%03u ns/glyph, %u hits, %u misses\r\n"), name, psPerGlyph / 1000, psPerGlyph % 1000,
+				  cache.getHits(), cache.getMisses());
+}
+
+} // namespace
+
+void benchmarkGlyphs()
+{
+	Serial.printf(_F("\r\nGlyphs, %u x 8x8, cache %u bytes\r\n"), glyphCount, unsigned(cacheBudget));
+
+	using Format = VT100::FrameBufferDisplay::PixelFormat;
+	auto buffer = new(std::nothrow) uint8_t[width * height * 3];
+	if(buffer == nullptr) {
+		return;
+	}
+
+	{
+		VT100::FrameBufferDisplay display(buffer, width, height, Format::rgb565);
+		run("RGB565", display);
+		display.enableGlyphCache(cacheBudget);
+		run("RGB565 cached", display);
+	}
+
+	{
+		VT100::FrameBufferDisplay display(buffer, width, height, Format::rgb888);
+		run("RGB888", display);
+		display.enableGlyphCache(cacheBudget);
+		run("RGB888 cached", display);
+	}
+
+	delete[] buffer;
+}
@@ -0,0 +1,72 @@
+#include <SmingCore.h>
+#include <VT100/Scanner.h>
+#include "benchmark.h"
+
+namespace
+{
+#ifdef ARCH_HOST
+const size_t bufferSize = 1024 * 1024;
+const unsigned loopCount = 200;
+#else
+const size_t bufferSize = 4096;
+const unsigned loopCount = 50;
+#endif
+
+using ScanFunction = size_t (*)(const char* str, size_t length);
+
+// Consume a buffer the way nputs() does: skip text, then handle one control byte
+size_t consume(ScanFunction scan, const char* buffer, size_t length)
+{
+	size_t count = 0;
+	size_t pos = 0;
+	while(pos < length) {
+		pos += scan(&buffer[pos], length - pos);
+		++pos;
+		++count;
+	}
+	return count;
+}
+
+void run(const char* name, ScanFunction scan, const char* buffer, size_t length)
+{
+	volatile size_t result = 0;
+	auto start = micros();
+	for(unsigned i = 0; i < loopCount; ++i) {
+		result += consume(scan, buffer, length);
+	}
+	auto elapsed = micros() - start;
+	if(elapsed == 0) {
+		elapsed = 1;
+	}
+	uint64_t bytes = uint64_t(length) * loopCount;
+	unsigned mbps = bytes / elapsed;
+	unsigned psPerByte = elapsed * 1000000ULL / bytes;
+	Serial.printf(_F("  %s: %u MB/s, %u ps/byte\r\n"), name, mbps, psPerByte);
+	(void)result;
+}
+
+} // namespace
+
+void benchmarkScanner()
+{
+	Serial.printf(_F("Scanner (%s), %u bytes x %u\r\n"), VT100::scanTextMethod, unsigned(bufferSize), loopCount);
+
+	auto buffer = new char[bufferSize];
+	if(buffer == nullptr) {
+		return;
+	}
+
+	static const unsigned lineLengths[] = {8, 40, 80, 1024};
+	for(auto lineLength : lineLengths) {
+		for(size_t i = 0; i < bufferSize; ++i) {
+			buffer[i] = ((i + 1) % lineLength == 0) ? '\n' : char(0x20 + (i % 0x5f));
+		}
+
+		Serial.printf(_F(" Line length %u\r\n"), lineLength);
+		run("scalar", VT100::scanTextScalar, buffer, bufferSize);
+		run("SWAR", VT100::scanTextSwar, buffer, bufferSize);
+		run("scanText", VT100::scanText, buffer, bufferSize);
+	}
+
+	delete[] buffer;
+}
@@ -0,0 +1,69 @@
+#include <SmingCore.h>
+#include "benchmark.h"
+
+#ifdef ARCH_HOST
+
+#include <VT100/SessionManager.h>
+#include <thread>
+#include <vector>
+#include "Workloads.h"
+
+namespace
+{
+const unsigned sessionCount = 64;
+const size_t bytesPerSession = 256 * 1024;
+// Bytes passed to each write(), as if read from a network socket
+const size_t chunkSize = 256;
+
+void run(unsigned threadCount, const std::vector<std::string>& data)
+{
+	VT100::SessionManager manager(threadCount);
+	VT100::Session* sessions[sessionCount];
+	for(unsigned i = 0; i < sessionCount; ++i) {
+		sessions[i] = manager.createSession(80, 24);
+		if(sessions[i] == nullptr) {
+			return;
+		}
+	}
+
+	// Interleave input across sessions, as a server with many connections would see it
+	auto start = micros();
+	for(size_t pos = 0; pos < bytesPerSession; pos += chunkSize) {
+		for(unsigned i = 0; i < sessionCount; ++i) {
+			auto& d = data[i % Workloads::count];
+			if(pos < d.size()) {
+				manager.write(*sessions[i], &d[pos], std::min(chunkSize, d.size() - pos));
+			}
+		}
+	}
+	manager.waitIdle();
+	auto elapsed = micros() - start;
+
+	uint64_t total = 0;
+	for(auto session : sessions) {
+		total += session->getBytesProcessed();
+	}
+	unsigned kbPerSec = total * 1000 / std::max(elapsed, 1U);
+	Serial.printf(_F("  %2u threads: %u.%03u MB/s\r\n"), manager.getThreadCount(), kbPerSec / 1000,
+				  kbPerSec % 1000);
+}
+
+} // namespace
+
+void benchmarkSessions()
+{
+	Serial.printf(_F("\r\nSessions, %u x 80x24, %u KB each\r\n"), sessionCount, unsigned(bytesPerSession / 1024));
+
+	std::vector<std::string> data(Workloads::count);
+	for(unsigned i = 0; i < Workloads::count; ++i) {
+		Workloads::all[i].generate(data[i], bytesPerSession);
+	}
+
+	unsigned hardwareThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	for(unsigned threads = 1; threads < hardwareThreads; threads *= 2) {
+		run(threads, data);
+	}
+	run(hardwareThreads, data);
+}
+
+#endif
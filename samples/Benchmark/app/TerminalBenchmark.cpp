@@ -0,0 +1,277 @@
+#include <SmingCore.h>
+#include <new>
+#include <VT100/Terminal.h>
+#include <VT100/FrameBufferDisplay.h>
+#include "Workloads.h"
+#include "benchmark.h"
+
+namespace
+{
+#ifdef ARCH_HOST
+const size_t workloadSize = 1024 * 1024;
+const unsigned loopCount = 5;
+#else
+const size_t workloadSize = 16 * 1024;
+const unsigned loopCount = 2;
+#endif
+
+// Bytes passed to each nputs() call, as if read from a serial or network buffer
+const size_t chunkSize = 256;
+// Simulated time advanced per chunk when frame pacing, in milliseconds
+const unsigned chunkTime = 2;
+
+/*
+ * Display which does nothing, so figures show the cost of the terminal alone
+ */
+class NullDisplay : public VT100::Display
+{
+public:
+	void drawString(uint16_t, uint16_t, const char*) override
+	{
+	}
+
+	void drawChar(uint16_t, uint16_t, uint8_t) override
+	{
+	}
+
+	void drawCells(uint16_t, uint16_t, const uint8_t*, const VT100::CellAttr*, size_t) override
+	{
+	}
+
+	void setBackColor(uint16_t) override
+	{
+	}
+
+	void setFrontColor(uint16_t) override
+	{
+	}
+
+	void fillRect(uint16_t, uint16_t, uint16_t, uint16_t, uint16_t) override
+	{
+	}
+
+	void scroll(uint16_t, uint16_t, int16_t) override
+	{
+	}
+
+	uint16_t getWidth() override
+	{
+		return 640;
+	}
+
+	uint16_t getHeight() override
+	{
+		return 192;
+	}
+
+	uint8_t getCharWidth() override
+	{
+		return 8;
+	}
+
+	uint8_t getCharHeight() override
+	{
+		return 8;
+	}
+};
+
+/*
+ * Display which counts calls and the pixels each would have written
+ */
+class CountingDisplay : public NullDisplay
+{
+public:
+	struct Counts {
+		uint32_t calls;
+		uint32_t chars;
+		uint32_t fills;
+		uint32_t scrolls;
+		uint64_t pixels;
+	};
+
+	void reset()
+	{
+		counts = Counts{};
+	}
+
+	const Counts& getCounts() const
+	{
+		return counts;
+	}
+
+	void drawString(uint16_t, uint16_t, const char* text) override
+	{
+		++counts.calls;
+		auto len = strlen(text);
+		counts.chars += len;
+		counts.pixels += len * getCharWidth() * getCharHeight();
+	}
+
+	void drawChar(uint16_t, uint16_t, uint8_t) override
+	{
+		++counts.calls;
+		++counts.chars;
+		counts.pixels += getCharWidth() * getCharHeight();
+	}
+
+	void drawCells(uint16_t, uint16_t, const uint8_t*, const VT100::CellAttr*, size_t count) override
+	{
+		++counts.calls;
+		counts.chars += count;
+		counts.pixels += count * getCharWidth() * getCharHeight();
+	}
+
+	void setBackColor(uint16_t) override
+	{
+		++counts.calls;
+	}
+
+	void setFrontColor(uint16_t) override
+	{
+		++counts.calls;
+	}
+
+	void fillRect(uint16_t, uint16_t, uint16_t w, uint16_t h, uint16_t) override
+	{
+		++counts.calls;
+		++counts.fills;
+		counts.pixels += w * h;
+	}
+
+	void scroll(uint16_t top, uint16_t bottom, int16_t) override
+	{
+		++counts.calls;
+		++counts.scrolls;
+		counts.pixels += (bottom - top) * getWidth();
+	}
+
+private:
+	Counts counts{};
+};
+
+class NullCallbacks : public VT100::Callbacks
+{
+public:
+	void sendResponse(const char*) override
+	{
+	}
+};
+
+enum class Mode {
+	direct,
+	grid,
+	paced,
+};
+
+const char* const modeNames[] = {"direct", "grid", "paced"};
+
+bool configure(VT100::Terminal& terminal, Mode mode)
+{
+	switch(mode) {
+	case Mode::grid:
+		return terminal.enableCellGrid(true);
+	case Mode::paced:
+		return terminal.enableFramePacing(60);
+	default:
+		return true;
+	}
+}
+
+// Replay workload once in chunks, returning elapsed microseconds
+uint32_t replay(VT100::Terminal& terminal, Mode mode, const std::string& data)
+{
+	uint32_t now = 0;
+	auto start = micros();
+	for(size_t pos = 0; pos < data.size(); pos += chunkSize) {
+		terminal.nputs(&data[pos], std::min(chunkSize, data.size() - pos));
+		if(mode == Mode::paced) {
+			now += chunkTime;
+			terminal.present(now);
+		}
+	}
+	if(mode == Mode::paced) {
+		terminal.present(now + 1000);
+	}
+	return micros() - start;
+}
+
+// Time replays of a workload, in microseconds
+uint32_t measure(VT100::Display& display, Mode mode, const std::string& data)
+{
+	NullCallbacks callbacks;
+	VT100::Terminal terminal(display, callbacks);
+	terminal.reset();
+	if(!configure(terminal, mode)) {
+		return 0;
+	}
+	uint32_t elapsed = 0;
+	for(unsigned i = 0; i < loopCount; ++i) {
+		elapsed += replay(terminal, mode, data);
+	}
+	return std::max(elapsed, 1U);
+}
+
+uint8_t* framebuffer;
+
+void run(const Workloads::Workload& workload, Mode mode)
+{
+	std::string data;
+	data.reserve(workloadSize + 256);
+	workload.generate(data, workloadSize);
+
+	// Timing against null display
+	NullDisplay nullDisplay;
+	auto elapsed = measure(nullDisplay, mode, data);
+	if(elapsed == 0) {
+		Serial.printf(_F("  %s: %s unavailable\r\n"), workload.name, modeNames[unsigned(mode)]);
+		return;
+	}
+
+	// Timing including rendering into a framebuffer, where there's memory for one
+	uint32_t renderElapsed = 0;
+	if(framebuffer != nullptr) {
+		VT100::FrameBufferDisplay fbDisplay(framebuffer, nullDisplay.getWidth(), nullDisplay.getHeight(),
+											VT100::FrameBufferDisplay::PixelFormat::rgb565);
+		renderElapsed = measure(fbDisplay, mode, data);
+	}
+
+	// Single pass to count display activity
+	NullCallbacks callbacks;
+	CountingDisplay countingDisplay;
+	VT100::Terminal counter(countingDisplay, callbacks);
+	counter.reset();
+	configure(counter, mode);
+	countingDisplay.reset();
+	replay(counter, mode, data);
+	auto& counts = countingDisplay.getCounts();
+
+	uint64_t bytes = uint64_t(data.size()) * loopCount;
+	unsigned mbps = bytes / elapsed;
+	unsigned nsPerByte = elapsed * 1000ULL / bytes;
+	unsigned renderMbps = (renderElapsed == 0) ? 0 : bytes / renderElapsed;
+	// Scale counts to one megabyte of input
+	auto perMB = [&](uint64_t count) -> unsigned { return count * 1024 * 1024 / data.size(); };
+	Serial.printf(_F("  %-14s %-6s %5u MB/s %5u ns/byte %5u MB/s rendered %9u calls/MB %11u pixels/MB (%u chars, "
+					 "%u fills, %u scrolls)\r\n"),
+				  workload.name, modeNames[unsigned(mode)], mbps, nsPerByte, renderMbps, perMB(counts.calls),
+				  perMB(counts.pixels), counts.chars, counts.fills, counts.scrolls);
+}
+
+} // namespace
+
+void benchmarkTerminal()
+{
+	Serial.printf(_F("\r\nTerminal, %u bytes x %u\r\n"), unsigned(workloadSize), loopCount);
+
+	// 640 x 192 pixels, RGB565
+	framebuffer = new(std::nothrow) uint8_t[640 * 192 * 2];
+
+	for(unsigned i = 0; i < Workloads::count; ++i) {
+		for(auto mode : {Mode::direct, Mode::grid, Mode::paced}) {
+			run(Workloads::all[i], mode);
+		}
+	}
+
+	delete[] framebuffer;
+	framebuffer = nullptr;
+}
@@ -0,0 +1,167 @@
+#include "Workloads.h"
+#include <m_printf.h>
+#include <cstdarg>
+#include <cstdint>
+
+namespace Workloads
+{
+namespace
+{
+// Deterministic pseudo-random sequence so every run replays the same bytes
+class Random
+{
+public:
+	unsigned next(unsigned range)
+	{
+		state = state * 1103515245 + 12345;
+		return (state >> 16) % range;
+	}
+
+private:
+	uint32_t state{1};
+};
+
+void append(std::string& out, const char* fmt, ...)
+{
+	char buf[256];
+	va_list args;
+	va_start(args, fmt);
+	int n = m_vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	out.append(buf, n);
+}
+
+const char* const words[] = {
+	"usb",   "device", "new",  "high-speed", "number", "using", "ehci-pci", "eth0",   "link",	 "up",
+	"100Mbps", "full", "duplex", "mounted", "filesystem", "with", "ordered", "data",  "mode", "ready",
+};
+const unsigned wordCount = sizeof(words) / sizeof(words[0]);
+
+const char* const colors[] = {"01;34", "01;32", "01;36", "00", "01;35", "40;33;01"};
+
+} // namespace
+
+void logSpew(std::string& out, size_t size)
+{
+	Random rnd;
+	for(unsigned line = 0; out.size() < size; ++line) {
+		append(out, "[%5u.%06u] ", line / 100, rnd.next(1000000));
+		for(unsigned n = 3 + rnd.next(10); n != 0; --n) {
+			out += words[rnd.next(wordCount)];
+			out += ' ';
+		}
+		out += "\r\n";
+	}
+}
+
+void lsColor(std::string& out, size_t size)
+{
+	Random rnd;
+	while(out.size() < size) {
+		for(unsigned col = 0; col < 4; ++col) {
+			append(out, "\x1b[0m\x1b[%sm%s_%u\x1b[0m  ", colors[rnd.next(6)], words[rnd.next(wordCount)], rnd.next(100));
+		}
+		out += "\r\n";
+	}
+}
+
+void htop(std::string& out, size_t size)
+{
+	Random rnd;
+	while(out.size() < size) {
+		out += "\x1b[H";
+		for(unsigned cpu = 1; cpu <= 4; ++cpu) {
+			append(out, "\x1b[%u;1H\x1b[0m%3u\x1b[1m[", cpu, cpu);
+			unsigned used = rnd.next(30);
+			out += "\x1b[32m";
+			out.append(used / 2, '|');
+			out += "\x1b[31m";
+			out.append(used - used / 2, '|');
+			append(out, "\x1b[%u;36H\x1b[0m%3u.%u%%]\x1b[K", cpu, rnd.next(100), rnd.next(10));
+		}
+		append(out, "\x1b[6;1H\x1b[30;42m  PID USER      PRI  NI  VIRT   RES S CPU%% MEM%%\x1b[K\x1b[0m");
+		for(unsigned row = 7; row <= 24; ++row) {
+			append(out, "\x1b[%u;1H%5u root       20   0 %5uM %5uM S %4u %4u\x1b[K", row, 100 + row * 7,
+				   rnd.next(2000), rnd.next(500), rnd.next(100), rnd.next(100));
+		}
+	}
+}
+
+void vim(std::string& out, size_t size)
+{
+	Random rnd;
+	out += "\x1b[?1049h\x1b[H\x1b[2J";
+	while(out.size() < size) {
+		switch(rnd.next(4)) {
+		case 0: // insert text at random position
+			append(out, "\x1b[%u;%uH%s %s", 1 + rnd.next(22), 1 + rnd.next(60), words[rnd.next(wordCount)],
+				   words[rnd.next(wordCount)]);
+			break;
+		case 1: // scroll the text area down one line
+			append(out, "\x1b[1;23r\x1b[23;1H\n\x1b[r\x1b[23;1H~\x1b[K");
+			break;
+		case 2: // scroll back up
+			append(out, "\x1b[1;23r\x1b[1;1H\x1bM\x1b[r\x1b[1;1H%s\x1b[K", words[rnd.next(wordCount)]);
+			break;
+		default: // status line
+			append(out, "\x1b[24;1H\x1b[7m\"file.c\" %u lines\x1b[27m\x1b[K\x1b[%u;%uH", rnd.next(1000), 1 + rnd.next(22),
+				   1 + rnd.next(60));
+		}
+	}
+}
+
+void scrolling(std::string& out, size_t size)
+{
+	Random rnd;
+	out += "\x1b[?7h";
+	while(out.size() < size) {
+		for(unsigned n = 10 + rnd.next(40); n != 0; --n) {
+			out += words[rnd.next(wordCount)];
+			out += ' ';
+		}
+		out += "\r\n";
+	}
+}
+
+void scrollRegion(std::string& out, size_t size)
+{
+	Random rnd;
+	while(out.size() < size) {
+		unsigned top = 1 + rnd.next(10);
+		unsigned bottom = top + 5 + rnd.next(8);
+		append(out, "\x1b[%u;%ur\x1b[%u;1H", top, bottom, bottom);
+		for(unsigned n = 0; n < 8; ++n) {
+			append(out, "\n%s", words[rnd.next(wordCount)]);
+		}
+		append(out, "\x1b[%u;1H", top);
+		for(unsigned n = 0; n < 8; ++n) {
+			append(out, "\x1bM%s", words[rnd.next(wordCount)]);
+		}
+		out += "\x1b[r";
+	}
+}
+
+void sgrHeavy(std::string& out, size_t size)
+{
+	Random rnd;
+	while(out.size() < size) {
+		for(unsigned col = 0; col < 60; ++col) {
+			if(rnd.next(2)) {
+				append(out, "\x1b[38;5;%um", rnd.next(256));
+			} else {
+				append(out, "\x1b[38;2;%u;%u;%u;48;5;%um", rnd.next(256), rnd.next(256), rnd.next(256), rnd.next(16));
+			}
+			out += char('!' + rnd.next(90));
+		}
+		out += "\x1b[0m\r\n";
+	}
+}
+
+const Workload all[] = {
+	{"log", logSpew},		  {"ls --color", lsColor}, {"htop", htop},		   {"vim", vim},
+	{"scrolling", scrolling}, {"scroll-region", scrollRegion}, {"sgr", sgrHeavy},
+};
+
+const unsigned count = sizeof(all) / sizeof(all[0]);
+
+} // namespace Workloads
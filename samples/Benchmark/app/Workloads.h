@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+/*
+ * Synthetic recordings of typical terminal output.
+ * Each generator appends roughly `size` bytes to `out`, always producing the same data.
+ */
+namespace Workloads
+{
+using Generator = void (*)(std::string& out, size_t size);
+
+struct Workload {
+	const char* name;
+	Generator generate;
+};
+
+// Kernel log spew, plain text
+void logSpew(std::string& out, size_t size);
+// Colourised directory listings
+void lsColor(std::string& out, size_t size);
+// Full-screen process monitor repainting every row
+void htop(std::string& out, size_t size);
+// Editor session: cursor movement, edits, status line, region scrolling
+void vim(std::string& out, size_t size);
+// Long wrapping lines scrolling the whole screen
+void scrolling(std::string& out, size_t size);
+// Scroll region stress: index/reverse index within margins
+void scrollRegion(std::string& out, size_t size);
+// 256-colour and truecolour attribute changes on most characters
+void sgrHeavy(std::string& out, size_t size);
+
+extern const Workload all[];
+extern const unsigned count;
+
+} // namespace Workloads
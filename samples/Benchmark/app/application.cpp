@@ -0,0 +1,24 @@
+#include <SmingCore.h>
+#include "benchmark.h"
+
+void init()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	Serial.systemDebugOutput(true);
+
+	Serial.println(_F("\r\nVT100 Benchmark\r\n"));
+
+	benchmarkScanner();
+	benchmarkTerminal();
+	benchmarkGlyphs();
+	benchmarkDispatch();
+#ifdef ARCH_HOST
+	benchmarkSessions();
+#endif
+
+	Serial.println(_F("\r\nDone."));
+
+#ifdef ARCH_HOST
+	System.restart();
+#endif
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+void benchmarkScanner();
+void benchmarkTerminal();
+void benchmarkGlyphs();
+void benchmarkDispatch();
+
+#ifdef ARCH_HOST
+void benchmarkSessions();
+#endif
@@ -0,0 +1 @@
+COMPONENT_DEPENDS := VT100
@@ -0,0 +1,148 @@
+#include <SmingCore.h>
+
+#ifdef ARCH_HOST
+
+#include <hostlib/CommandLine.h>
+#include <VT100/RecordingFile.h>
+#include <VT100/FrameBufferDisplay.h>
+#include <VT100/CellDisplay.h>
+#include <memory>
+
+using namespace VT100;
+
+namespace
+{
+class NullCallbacks : public Callbacks
+{
+public:
+	void sendResponse(const char*) override
+	{
+	}
+};
+
+String getParameter(const char* name, const char* defaultValue = nullptr)
+{
+	auto param = commandLine.getParameters().find(name);
+	return param ? param.getValue() : String(defaultValue);
+}
+
+// Convert a raw capture into a recording, timed as if it arrived over a serial line
+bool record(const String& captureName, const String& fileName, unsigned baud)
+{
+	FILE* capture = fopen(captureName.c_str(), "rb");
+	if(capture == nullptr) {
+		Serial.printf(_F("Cannot open '%s'\r\n"), captureName.c_str());
+		return false;
+	}
+
+	CellDisplay display(80, 24);
+	NullCallbacks callbacks;
+	Terminal terminal(display, callbacks);
+	terminal.reset();
+	terminal.enableCellGrid(true);
+
+	RecordingFileWriter writer;
+	Recorder recorder(terminal);
+	if(!writer.open(fileName.c_str()) || !recorder.begin(writer)) {
+		Serial.printf(_F("Cannot create '%s'\r\n"), fileName.c_str());
+		fclose(capture);
+		return false;
+	}
+
+	// 10 bits per character, including start and stop bits
+	uint64_t total{0};
+	char buffer[256];
+	size_t len;
+	while((len = fread(buffer, 1, sizeof(buffer), capture)) != 0) {
+		total += len;
+		recorder.write(buffer, len, total * 10000 / baud);
+	}
+	fclose(capture);
+
+	bool ok = recorder.end(total * 10000 / baud);
+	Serial.printf(_F("Recorded %llu bytes, %u ms\r\n"), total, unsigned(total * 10000 / baud));
+	return ok;
+}
+
+bool writeImage(const String& fileName, const FrameBufferDisplay& display, uint16_t width, uint16_t height)
+{
+	FILE* file = fopen(fileName.c_str(), "wb");
+	if(file == nullptr) {
+		return false;
+	}
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	for(unsigned y = 0; y < height; ++y) {
+		fwrite(display.getBuffer() + y * display.getStride(), 3, width, file);
+	}
+	return fclose(file) == 0;
+}
+
+bool replay()
+{
+	String fileName = getParameter("file");
+	if(!fileName) {
+		Serial.println(_F("Usage: file=RECORDING [time=MS] [out=IMAGE.ppm] [record=CAPTURE [baud=RATE]]"));
+		return false;
+	}
+
+	String captureName = getParameter("record");
+	if(captureName && !record(captureName, fileName, getParameter("baud", "115200").toInt())) {
+		return false;
+	}
+
+	RecordingFileReader reader;
+	Player player;
+	if(!reader.open(fileName.c_str()) || !player.begin(reader)) {
+		Serial.printf(_F("Cannot read recording '%s'\r\n"), fileName.c_str());
+		return false;
+	}
+
+	uint16_t width = player.getColumnCount() * 8;
+	uint16_t height = player.getRowCount() * 8;
+	std::unique_ptr<uint8_t[]> pixels(new uint8_t[width * height * 3]);
+	FrameBufferDisplay display(pixels.get(), width, height, FrameBufferDisplay::PixelFormat::rgb888);
+	NullCallbacks callbacks;
+	Terminal terminal(display, callbacks);
+	terminal.reset();
+	terminal.enableCellGrid(true);
+
+	String time = getParameter("time");
+	uint32_t timestamp = time ? uint32_t(time.toInt()) : player.getDuration();
+	Serial.printf(_F("%u x %u, %u ms, %u keyframes\r\n"), player.getColumnCount(), player.getRowCount(),
+				  player.getDuration(), player.getKeyframeCount());
+
+	auto start = micros();
+	if(!player.seek(terminal, timestamp)) {
+		Serial.println(_F("Seek failed"));
+		return false;
+	}
+	terminal.flush();
+	Serial.printf(_F("Seek to %u ms took %u us\r\n"), timestamp, unsigned(micros() - start));
+
+	String outName = getParameter("out", "replay.ppm");
+	if(!writeImage(outName, display, width, height)) {
+		Serial.printf(_F("Cannot write '%s'\r\n"), outName.c_str());
+		return false;
+	}
+	Serial.printf(_F("Wrote '%s'\r\n"), outName.c_str());
+	return true;
+}
+
+} // namespace
+
+#endif
+
+void init()
+{
+	Serial.begin(SERIAL_BAUD_RATE);
+	Serial.systemDebugOutput(true);
+
+	Serial.println(_F("\r\nVT100 Replay\r\n"));
+
+#ifdef ARCH_HOST
+	replay();
+	System.restart();
+#else
+	Serial.println(_F("Host builds only"));
+#endif
+}
@@ -0,0 +1,133 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+#include "include/VT100/CellDisplay.h"
+
+namespace VT100
+{
+CellDisplay::CellDisplay(uint16_t cols, uint16_t rows) : colCount(cols), rowCount(rows)
+{
+	chars = new(std::nothrow) uint8_t[cols * rows];
+	attrs = new(std::nothrow) CellAttr[cols * rows];
+	if(!isAllocated()) {
+		delete[] chars;
+		chars = nullptr;
+		delete[] attrs;
+		attrs = nullptr;
+		colCount = rowCount = 0;
+		return;
+	}
+	fillRect(0, 0, cols, rows, 0);
+}
+
+bool CellDisplay::clip(uint16_t x, uint16_t y, uint16_t& w, uint16_t& h) const
+{
+	if(x >= colCount || y >= rowCount) {
+		return false;
+	}
+	w = std::min(w, uint16_t(colCount - x));
+	h = std::min(h, uint16_t(rowCount - y));
+	return w != 0 && h != 0;
+}
+
+void CellDisplay::drawChar(uint16_t x, uint16_t y, uint8_t c)
+{
+	if(x < colCount && y < rowCount) {
+		unsigned i = y * colCount + x;
+		chars[i] = c;
+		attrs[i] = current;
+	}
+}
+
+void CellDisplay::drawString(uint16_t x, uint16_t y, const char* text)
+{
+	while(*text != '\0') {
+		drawChar(x++, y, *text++);
+	}
+}
+
+void CellDisplay::drawCells(uint16_t x, uint16_t y, const uint8_t* chars, const CellAttr* attrs, size_t count)
+{
+	uint16_t w = std::min(count, size_t(0xffff));
+	uint16_t h = 1;
+	if(!clip(x, y, w, h)) {
+		return;
+	}
+	unsigned i = y * colCount + x;
+	memcpy(&this->chars[i], chars, w);
+	memcpy(&this->attrs[i], attrs, w * sizeof(CellAttr));
+}
+
+void CellDisplay::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+	if(!clip(x, y, w, h)) {
+		return;
+	}
+	CellAttr attr{current.frontColor, color};
+	for(unsigned row = y; row < unsigned(y + h); ++row) {
+		unsigned i = row * colCount + x;
+		memset(&chars[i], ' ', w);
+		std::fill_n(&attrs[i], w, attr);
+	}
+}
+
+void CellDisplay::scroll(uint16_t top, uint16_t bottom, int16_t diff)
+{
+	if(bottom >= rowCount) {
+		bottom = rowCount - 1;
+	}
+	unsigned n = abs(diff);
+	if(top > bottom || n == 0 || n > unsigned(bottom - top)) {
+		return;
+	}
+	unsigned keep = bottom + 1 - top - n;
+	unsigned src = ((diff > 0) ? top + n : top) * colCount;
+	unsigned dst = ((diff > 0) ? top : top + n) * colCount;
+	memmove(&chars[dst], &chars[src], keep * colCount);
+	memmove(&attrs[dst], &attrs[src], keep * colCount * sizeof(CellAttr));
+}
+
+bool CellDisplay::copyRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t destX, uint16_t destY)
+{
+	if(!clip(x, y, w, h) || !clip(destX, destY, w, h)) {
+		return true;
+	}
+
+	auto copyRow = [&](unsigned i) {
+		unsigned src = (y + i) * colCount + x;
+		unsigned dst = (destY + i) * colCount + destX;
+		memmove(&chars[dst], &chars[src], w);
+		memmove(&attrs[dst], &attrs[src], w * sizeof(CellAttr));
+	};
+	if(destY <= y) {
+		for(unsigned i = 0; i < h; ++i) {
+			copyRow(i);
+		}
+	} else {
+		for(unsigned i = h; i-- > 0;) {
+			copyRow(i);
+		}
+	}
+	return true;
+}
+
+} // namespace VT100
@@ -0,0 +1,213 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <new>
+
+#include "include/VT100/CellGrid.h"
+
+namespace VT100
+{
+bool CellGrid::resize(uint16_t cols, uint16_t rows)
+{
+	if(cells != nullptr && cols == colCount && rows == rowCount) {
+		return true;
+	}
+
+	free();
+
+	if(storage.cells != nullptr) {
+		if(cols != storage.cols || rows != storage.rows) {
+			return false;
+		}
+		cells = storage.cells;
+		dirty = storage.dirty;
+	} else {
+		cells = new(std::nothrow) Cell[cols * rows];
+		dirty = new(std::nothrow) Span[rows];
+	}
+	if(cells == nullptr || dirty == nullptr) {
+		free();
+		return false;
+	}
+
+	colCount = cols;
+	rowCount = rows;
+	memset(dirty, 0, rows * sizeof(Span));
+	return true;
+}
+
+void CellGrid::free()
+{
+	if(cells != storage.cells) {
+		delete[] cells;
+		delete[] dirty;
+	}
+	cells = nullptr;
+	dirty = nullptr;
+	colCount = rowCount = 0;
+}
+
+void CellGrid::markDirty(uint16_t row, uint16_t startCol, uint16_t endCol)
+{
+	auto& span = dirty[row];
+	if(span.empty()) {
+		span = {startCol, endCol};
+		return;
+	}
+	if(startCol < span.start) {
+		span.start = startCol;
+	}
+	if(endCol > span.end) {
+		span.end = endCol;
+	}
+}
+
+bool CellGrid::set(uint16_t col, uint16_t row, Cell cell)
+{
+	if(col >= colCount || row >= rowCount) {
+		return false;
+	}
+
+	auto& c = cells[row * colCount + col];
+	if(c == cell) {
+		return false;
+	}
+
+	c = cell;
+	markDirty(row, col, col + 1);
+	return true;
+}
+
+void CellGrid::fill(uint16_t row, uint16_t startCol, uint16_t endCol, Cell cell)
+{
+	if(row >= rowCount) {
+		return;
+	}
+	if(endCol > colCount) {
+		endCol = colCount;
+	}
+
+	// Only the range which actually changes needs to be marked
+	auto p = this->row(row);
+	int first = -1;
+	int last = -1;
+	for(unsigned c = startCol; c < endCol; ++c) {
+		if(p[c] != cell) {
+			p[c] = cell;
+			if(first < 0) {
+				first = c;
+			}
+			last = c;
+		}
+	}
+	if(first >= 0) {
+		markDirty(row, first, last + 1);
+	}
+}
+
+void CellGrid::reset(uint16_t row, Cell cell)
+{
+	if(row >= rowCount) {
+		return;
+	}
+	auto p = this->row(row);
+	for(unsigned c = 0; c < colCount; ++c) {
+		p[c] = cell;
+	}
+	dirty[row] = {0, colCount};
+}
+
+void CellGrid::scroll(uint16_t top, uint16_t bottom, int16_t lines, Cell fill)
+{
+	if(bottom >= rowCount) {
+		bottom = rowCount - 1;
+	}
+	if(lines == 0 || top > bottom) {
+		return;
+	}
+
+	unsigned count = bottom + 1 - top;
+	unsigned n = (lines > 0) ? lines : -lines;
+	if(n > count) {
+		n = count;
+	}
+	unsigned keep = count - n;
+	unsigned exposed;
+	if(lines > 0) {
+		memmove(row(top), row(top + n), keep * colCount * sizeof(Cell));
+		memmove(&dirty[top], &dirty[top + n], keep * sizeof(Span));
+		exposed = top + keep;
+	} else {
+		memmove(row(top + n), row(top), keep * colCount * sizeof(Cell));
+		memmove(&dirty[top + n], &dirty[top], keep * sizeof(Span));
+		exposed = top;
+	}
+
+	for(unsigned r = exposed; r < exposed + n; ++r) {
+		reset(r, fill);
+	}
+}
+
+void CellGrid::shift(uint16_t row, uint16_t startCol, int16_t count, Cell fill)
+{
+	if(row >= rowCount || startCol >= colCount || count == 0) {
+		return;
+	}
+
+	auto p = this->row(row);
+	int first = -1;
+	int last = -1;
+	auto update = [&](unsigned c, Cell cell) {
+		if(p[c] != cell) {
+			p[c] = cell;
+			if(first < 0 || int(c) < first) {
+				first = c;
+			}
+			if(int(c) > last) {
+				last = c;
+			}
+		}
+	};
+
+	// Copy in the direction which doesn't overwrite cells before they're moved
+	if(count > 0) {
+		for(int c = colCount - 1; c >= startCol; --c) {
+			update(c, (c - count >= startCol) ? p[c - count] : fill);
+		}
+	} else {
+		for(int c = startCol; c < colCount; ++c) {
+			update(c, (c - count < colCount) ? p[c - count] : fill);
+		}
+	}
+
+	if(first >= 0) {
+		markDirty(row, first, last + 1);
+	}
+}
+
+bool CellGrid::isDirty() const
+{
+	for(unsigned r = 0; r < rowCount; ++r) {
+		if(!dirty[r].empty()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace VT100
@@ -0,0 +1,458 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <m_printf.h>
+
+#include "include/VT100/Format.h"
+
+namespace VT100
+{
+namespace
+{
+enum class Length {
+	none,
+	hh,
+	h,
+	l,
+	ll,
+	z,
+	j,
+	t,
+	L,
+};
+
+struct Spec {
+	bool left{false};
+	bool plus{false};
+	bool space{false};
+	bool alt{false};
+	bool zero{false};
+	unsigned width{0};
+	int precision{-1};
+	Length length{Length::none};
+};
+
+class Formatter
+{
+public:
+	Formatter(FormatWriter writer, void* param) : writer(writer), param(param)
+	{
+	}
+
+	void put(const char* data, size_t length)
+	{
+		if(length != 0) {
+			writer(param, data, length);
+			count += length;
+		}
+	}
+
+	void pad(char c, size_t n)
+	{
+		static const char spaces[] = "                ";
+		static const char zeros[] = "0000000000000000";
+		const char* fill = (c == '0') ? zeros : spaces;
+		while(n != 0) {
+			auto len = std::min(n, sizeof(spaces) - 1);
+			put(fill, len);
+			n -= len;
+		}
+	}
+
+	// Pad to width either side of `length` characters of output
+	void padBefore(const Spec& spec, size_t length)
+	{
+		if(!spec.left && spec.width > length) {
+			pad(' ', spec.width - length);
+		}
+	}
+
+	void padAfter(const Spec& spec, size_t length)
+	{
+		if(spec.left && spec.width > length) {
+			pad(' ', spec.width - length);
+		}
+	}
+
+	void string(const Spec& spec, const char* s);
+	void integer(const Spec& spec, uint64_t value, bool negative, unsigned base, bool upper);
+	void floating(const Spec& spec, char conversion, double value);
+
+	size_t getCount() const
+	{
+		return count;
+	}
+
+private:
+	FormatWriter writer;
+	void* param;
+	size_t count{0};
+};
+
+void Formatter::string(const Spec& spec, const char* s)
+{
+	if(s == nullptr) {
+		s = "(null)";
+	}
+	size_t len = 0;
+	if(spec.precision < 0) {
+		len = strlen(s);
+	} else {
+		// Precision limits how much is read, so the string needn't be terminated
+		while(len < size_t(spec.precision) && s[len] != '\0') {
+			++len;
+		}
+	}
+	padBefore(spec, len);
+	put(s, len);
+	padAfter(spec, len);
+}
+
+void Formatter::integer(const Spec& spec, uint64_t value, bool negative, unsigned base, bool upper)
+{
+	// Enough for 64 bits in octal
+	char digits[22];
+	auto digitChars = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	bool zero = (value == 0);
+	size_t digitCount = 0;
+	if(value != 0 || spec.precision != 0) {
+		do {
+			digits[sizeof(digits) - 1 - digitCount++] = digitChars[value % base];
+			value /= base;
+		} while(value != 0);
+	}
+
+	char prefix[2];
+	size_t prefixLength = 0;
+	if(negative) {
+		prefix[prefixLength++] = '-';
+	} else if(spec.plus) {
+		prefix[prefixLength++] = '+';
+	} else if(spec.space) {
+		prefix[prefixLength++] = ' ';
+	}
+	if(spec.alt && base == 16 && !zero) {
+		prefix[prefixLength++] = '0';
+		prefix[prefixLength++] = upper ? 'X' : 'x';
+	}
+
+	size_t precisionZeros = (spec.precision > 0 && size_t(spec.precision) > digitCount) ? spec.precision - digitCount : 0;
+	if(spec.alt && base == 8 && precisionZeros == 0 && (digitCount == 0 || digits[sizeof(digits) - digitCount] != '0')) {
+		precisionZeros = 1;
+	}
+
+	size_t length = prefixLength + precisionZeros + digitCount;
+	size_t widthZeros = 0;
+	if(spec.zero && !spec.left && spec.precision < 0 && spec.width > length) {
+		widthZeros = spec.width - length;
+		length = spec.width;
+	}
+
+	padBefore(spec, length);
+	put(prefix, prefixLength);
+	pad('0', widthZeros + precisionZeros);
+	put(&digits[sizeof(digits) - digitCount], digitCount);
+	padAfter(spec, length);
+}
+
+void Formatter::floating(const Spec& spec, char conversion, double value)
+{
+	// Rebuild the conversion for m_snprintf()
+	char fmt[32];
+	auto p = fmt;
+	*p++ = '%';
+	if(spec.plus) {
+		*p++ = '+';
+	}
+	if(spec.space) {
+		*p++ = ' ';
+	}
+	if(spec.alt) {
+		*p++ = '#';
+	}
+	if(spec.zero) {
+		*p++ = '0';
+	}
+	auto number = [&p](unsigned n) {
+		char digits[10];
+		unsigned i = 0;
+		do {
+			digits[i++] = '0' + (n % 10);
+			n /= 10;
+		} while(n != 0);
+		while(i != 0) {
+			*p++ = digits[--i];
+		}
+	};
+	// Zero padding goes between sign and digits, so leave that to m_snprintf()
+	bool zeroPad = spec.zero && !spec.left;
+	if(zeroPad && spec.width != 0) {
+		number(spec.width);
+	}
+	if(spec.precision >= 0) {
+		*p++ = '.';
+		number(spec.precision);
+	}
+	*p++ = conversion;
+	*p = '\0';
+
+	// Covers everything except %f with large values
+	char buf[48];
+	int n = m_snprintf(buf, sizeof(buf), fmt, value);
+	if(n < 0) {
+		return;
+	}
+	padBefore(spec, n);
+	if(size_t(n) < sizeof(buf)) {
+		put(buf, n);
+	} else {
+		auto big = new(std::nothrow) char[n + 1];
+		if(big == nullptr) {
+			put(buf, sizeof(buf) - 1);
+		} else {
+			m_snprintf(big, n + 1, fmt, value);
+			put(big, n);
+			delete[] big;
+		}
+	}
+	padAfter(spec, n);
+}
+
+} // namespace
+
+size_t formatStream(FormatWriter writer, void* param, const char* fmt, va_list args)
+{
+	Formatter out(writer, param);
+
+	// Copy so va_arg can be used from here regardless of how va_list is implemented
+	va_list ap;
+	va_copy(ap, args);
+
+	while(*fmt != '\0') {
+		// Literal text goes out as-is
+		auto start = fmt;
+		while(*fmt != '\0' && *fmt != '%') {
+			++fmt;
+		}
+		out.put(start, fmt - start);
+		if(*fmt == '\0') {
+			break;
+		}
+		start = fmt++;
+
+		Spec spec;
+		for(;; ++fmt) {
+			if(*fmt == '-') {
+				spec.left = true;
+			} else if(*fmt == '+') {
+				spec.plus = true;
+			} else if(*fmt == ' ') {
+				spec.space = true;
+			} else if(*fmt == '#') {
+				spec.alt = true;
+			} else if(*fmt == '0') {
+				spec.zero = true;
+			} else {
+				break;
+			}
+		}
+
+		if(*fmt == '*') {
+			int width = va_arg(ap, int);
+			if(width < 0) {
+				spec.left = true;
+				width = -width;
+			}
+			spec.width = width;
+			++fmt;
+		} else {
+			while(*fmt >= '0' && *fmt <= '9') {
+				spec.width = spec.width * 10 + (*fmt++ - '0');
+			}
+		}
+
+		if(*fmt == '.') {
+			++fmt;
+			if(*fmt == '*') {
+				// Negative precision is taken as if omitted
+				spec.precision = std::max(va_arg(ap, int), -1);
+				++fmt;
+			} else {
+				spec.precision = 0;
+				while(*fmt >= '0' && *fmt <= '9') {
+					spec.precision = spec.precision * 10 + (*fmt++ - '0');
+				}
+			}
+		}
+
+		switch(*fmt) {
+		case 'h':
+			++fmt;
+			spec.length = (*fmt == 'h') ? (++fmt, Length::hh) : Length::h;
+			break;
+		case 'l':
+			++fmt;
+			spec.length = (*fmt == 'l') ? (++fmt, Length::ll) : Length::l;
+			break;
+		case 'z':
+			++fmt;
+			spec.length = Length::z;
+			break;
+		case 'j':
+			++fmt;
+			spec.length = Length::j;
+			break;
+		case 't':
+			++fmt;
+			spec.length = Length::t;
+			break;
+		case 'L':
+			++fmt;
+			spec.length = Length::L;
+			break;
+		default:;
+		}
+
+		char conversion = *fmt;
+		if(conversion == '\0') {
+			// Incomplete conversion at end of format
+			out.put(start, fmt - start);
+			break;
+		}
+		++fmt;
+
+		switch(conversion) {
+		case 'd':
+		case 'i': {
+			int64_t value;
+			switch(spec.length) {
+			case Length::hh:
+				value = (signed char)va_arg(ap, int);
+				break;
+			case Length::h:
+				value = short(va_arg(ap, int));
+				break;
+			case Length::l:
+				value = va_arg(ap, long);
+				break;
+			case Length::ll:
+				value = va_arg(ap, long long);
+				break;
+			case Length::z:
+			case Length::t:
+				value = va_arg(ap, ptrdiff_t);
+				break;
+			case Length::j:
+				value = va_arg(ap, intmax_t);
+				break;
+			default:
+				value = va_arg(ap, int);
+			}
+			bool negative = value < 0;
+			out.integer(spec, negative ? 0 - uint64_t(value) : uint64_t(value), negative, 10, false);
+			break;
+		}
+
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X': {
+			uint64_t value;
+			switch(spec.length) {
+			case Length::hh:
+				value = (unsigned char)va_arg(ap, unsigned);
+				break;
+			case Length::h:
+				value = (unsigned short)va_arg(ap, unsigned);
+				break;
+			case Length::l:
+				value = va_arg(ap, unsigned long);
+				break;
+			case Length::ll:
+				value = va_arg(ap, unsigned long long);
+				break;
+			case Length::z:
+			case Length::t:
+				value = va_arg(ap, size_t);
+				break;
+			case Length::j:
+				value = va_arg(ap, uintmax_t);
+				break;
+			default:
+				value = va_arg(ap, unsigned);
+			}
+			unsigned base = (conversion == 'u') ? 10 : (conversion == 'o') ? 8 : 16;
+			spec.plus = spec.space = false;
+			out.integer(spec, value, false, base, conversion == 'X');
+			break;
+		}
+
+		case 'p':
+			spec.alt = true;
+			spec.plus = spec.space = false;
+			out.integer(spec, uintptr_t(va_arg(ap, void*)), false, 16, false);
+			break;
+
+		case 'c': {
+			char c = char(va_arg(ap, int));
+			out.padBefore(spec, 1);
+			out.put(&c, 1);
+			out.padAfter(spec, 1);
+			break;
+		}
+
+		case 's':
+			out.string(spec, va_arg(ap, const char*));
+			break;
+
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			out.floating(spec, conversion,
+						 (spec.length == Length::L) ? double(va_arg(ap, long double)) : va_arg(ap, double));
+			break;
+
+		case 'n':
+			va_arg(ap, void*);
+			break;
+
+		case '%':
+			out.put("%", 1);
+			break;
+
+		default:
+			// Unknown conversion, output unchanged
+			out.put(start, fmt - start);
+		}
+	}
+
+	va_end(ap);
+
+	return out.getCount();
+}
+
+} // namespace VT100
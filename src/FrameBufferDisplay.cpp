@@ -0,0 +1,257 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "include/VT100/FrameBufferDisplay.h"
+
+namespace VT100
+{
+FrameBufferDisplay::FrameBufferDisplay(void* buffer, uint16_t width, uint16_t height, PixelFormat format,
+									   size_t stride, const Font& font)
+	: buffer(static_cast<uint8_t*>(buffer)), width(width), height(height), format(format),
+	  bytesPerPixel(format == PixelFormat::rgb888 ? 3 : 2), font(font)
+{
+	this->stride = (stride != 0) ? stride : width * bytesPerPixel;
+}
+
+void FrameBufferDisplay::encode(uint8_t* dst, uint16_t color) const
+{
+	if(format == PixelFormat::rgb565) {
+		memcpy(dst, &color, sizeof(color));
+		return;
+	}
+
+	// Expand each channel to 8 bits, replicating the high bits into the low ones
+	uint8_t r = (color >> 11) & 0x1f;
+	uint8_t g = (color >> 5) & 0x3f;
+	uint8_t b = color & 0x1f;
+	dst[0] = (r << 3) | (r >> 2);
+	dst[1] = (g << 2) | (g >> 4);
+	dst[2] = (b << 3) | (b >> 2);
+}
+
+uint16_t FrameBufferDisplay::getPixel(uint16_t x, uint16_t y) const
+{
+	if(x >= width || y >= height) {
+		return 0;
+	}
+	auto p = pixelAddress(x, y);
+	if(format == PixelFormat::rgb565) {
+		uint16_t color;
+		memcpy(&color, p, sizeof(color));
+		return color;
+	}
+	return ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+}
+
+void FrameBufferDisplay::updateExpand()
+{
+	uint8_t front[3];
+	uint8_t back[3];
+	encode(front, frontColor);
+	encode(back, backColor);
+
+	for(unsigned bits = 0; bits < 16; ++bits) {
+		auto dst = reinterpret_cast<uint8_t*>(expand[bits]);
+		for(unsigned i = 0; i < 4; ++i) {
+			memcpy(dst, (bits & (1 << i)) ? front : back, bytesPerPixel);
+			dst += bytesPerPixel;
+		}
+	}
+	expandValid = true;
+}
+
+bool FrameBufferDisplay::enableGlyphCache(size_t budget)
+{
+	if(budget == 0) {
+		glyphCache.end();
+		return true;
+	}
+	return glyphCache.begin(budget, font.width * font.height * bytesPerPixel);
+}
+
+void FrameBufferDisplay::drawChar(uint16_t x, uint16_t y, uint8_t c)
+{
+	if(x + font.width > width || y + font.height > height) {
+		return;
+	}
+
+	auto glyph = font.getGlyph(c);
+	auto dst = pixelAddress(x, y);
+	if(!glyphCache.isEnabled()) {
+		expandGlyph(dst, stride, glyph);
+		return;
+	}
+
+	// Cached glyphs are stored with rows packed together
+	unsigned rowSize = font.width * bytesPerPixel;
+	auto src = glyphCache.get(c, frontColor, backColor,
+							  [&](uint8_t* pixels) { expandGlyph(pixels, rowSize, glyph); });
+	auto copyRows = [&](unsigned size) {
+		for(unsigned i = 0; i < font.height; ++i) {
+			memcpy(dst, src, size);
+			dst += stride;
+			src += size;
+		}
+	};
+	// Constant sizes for the built-in font let the compiler use word moves
+	if(rowSize == 16) {
+		copyRows(16);
+	} else if(rowSize == 24) {
+		copyRows(24);
+	} else {
+		copyRows(rowSize);
+	}
+}
+
+void FrameBufferDisplay::expandGlyph(uint8_t* row, size_t dstStride, const uint8_t* glyph)
+{
+	if(!expandValid) {
+		updateExpand();
+	}
+
+	// Final nibble may be partial for fonts which aren't a multiple of 4 pixels wide
+	unsigned tailSize = (font.width % 4) * bytesPerPixel;
+	unsigned fullNibbles = font.width / 4;
+
+	for(unsigned i = 0; i < font.height; ++i) {
+		uint8_t bits = glyph[i];
+		auto dst = row;
+		if(format == PixelFormat::rgb565) {
+			for(unsigned n = 0; n < fullNibbles; ++n) {
+				memcpy(dst, expand[bits & 0x0f], 8);
+				dst += 8;
+				bits >>= 4;
+			}
+		} else {
+			for(unsigned n = 0; n < fullNibbles; ++n) {
+				memcpy(dst, expand[bits & 0x0f], 12);
+				dst += 12;
+				bits >>= 4;
+			}
+		}
+		if(tailSize != 0) {
+			memcpy(dst, expand[bits & 0x0f], tailSize);
+		}
+		row += dstStride;
+	}
+}
+
+void FrameBufferDisplay::drawString(uint16_t x, uint16_t y, const char* text)
+{
+	while(*text != '\0') {
+		drawChar(x, y, *text++);
+		x += font.width;
+	}
+}
+
+void FrameBufferDisplay::drawCells(uint16_t x, uint16_t y, const uint8_t* chars, const CellAttr* attrs, size_t count)
+{
+	drawCellRun(*this, x, y, font.width, chars, attrs, count);
+}
+
+void FrameBufferDisplay::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+	if(x >= width || y >= height) {
+		return;
+	}
+	w = std::min(w, uint16_t(width - x));
+	h = std::min(h, uint16_t(height - y));
+	if(w == 0 || h == 0) {
+		return;
+	}
+
+	// Fill the first row, then copy it to the rest
+	auto first = pixelAddress(x, y);
+	encode(first, color);
+	unsigned rowSize = w * bytesPerPixel;
+	for(unsigned filled = bytesPerPixel; filled < rowSize;) {
+		auto n = std::min(filled, rowSize - filled);
+		memcpy(first + filled, first, n);
+		filled += n;
+	}
+	auto dst = first;
+	for(unsigned i = 1; i < h; ++i) {
+		dst += stride;
+		memcpy(dst, first, rowSize);
+	}
+}
+
+void FrameBufferDisplay::scroll(uint16_t top, uint16_t bottom, int16_t diff)
+{
+	if(bottom >= height) {
+		bottom = height - 1;
+	}
+	if(top > bottom || diff == 0) {
+		return;
+	}
+
+	unsigned count = bottom + 1 - top;
+	unsigned n = std::abs(diff);
+	if(n >= count) {
+		return;
+	}
+	unsigned keep = count - n;
+	auto src = pixelAddress(0, (diff > 0) ? top + n : top);
+	auto dst = pixelAddress(0, (diff > 0) ? top : top + n);
+
+	// Contiguous rows move in one go
+	unsigned rowSize = width * bytesPerPixel;
+	if(stride == rowSize) {
+		memmove(dst, src, keep * stride);
+		return;
+	}
+
+	// Otherwise only touch the visible part of each row, in an order which doesn't overwrite the source
+	if(diff > 0) {
+		for(unsigned i = 0; i < keep; ++i) {
+			memmove(dst + i * stride, src + i * stride, rowSize);
+		}
+	} else {
+		for(unsigned i = keep; i-- > 0;) {
+			memmove(dst + i * stride, src + i * stride, rowSize);
+		}
+	}
+}
+
+bool FrameBufferDisplay::copyRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t destX, uint16_t destY)
+{
+	if(x >= width || y >= height || destX >= width || destY >= height) {
+		return true;
+	}
+	w = std::min({w, uint16_t(width - x), uint16_t(width - destX)});
+	h = std::min({h, uint16_t(height - y), uint16_t(height - destY)});
+
+	auto src = pixelAddress(x, y);
+	auto dst = pixelAddress(destX, destY);
+	unsigned rowSize = w * bytesPerPixel;
+	if(destY <= y) {
+		for(unsigned i = 0; i < h; ++i) {
+			memmove(dst + i * stride, src + i * stride, rowSize);
+		}
+	} else {
+		for(unsigned i = h; i-- > 0;) {
+			memmove(dst + i * stride, src + i * stride, rowSize);
+		}
+	}
+	return true;
+}
+
+} // namespace VT100
@@ -0,0 +1,177 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#include "include/VT100/GlyphCache.h"
+
+namespace VT100
+{
+bool GlyphCache::begin(size_t budget, size_t glyphSize)
+{
+	end();
+
+	// Allow one bucket per entry
+	size_t entrySize = sizeof(Entry) + sizeof(uint16_t) + glyphSize;
+	size_t count = std::min(budget / entrySize, size_t(none - 1));
+	if(glyphSize == 0 || count == 0) {
+		return false;
+	}
+
+	// Bucket count must be a power of 2
+	unsigned bucketCount = 1;
+	while(bucketCount * 2 <= count) {
+		bucketCount *= 2;
+	}
+
+	entries = new(std::nothrow) Entry[count];
+	buckets = new(std::nothrow) uint16_t[bucketCount];
+	pixels = new(std::nothrow) uint8_t[count * glyphSize];
+	if(entries == nullptr || buckets == nullptr || pixels == nullptr) {
+		end();
+		return false;
+	}
+
+	this->glyphSize = glyphSize;
+	this->bucketCount = bucketCount;
+	capacity = count;
+	clear();
+	return true;
+}
+
+void GlyphCache::end()
+{
+	delete[] entries;
+	entries = nullptr;
+	delete[] buckets;
+	buckets = nullptr;
+	delete[] pixels;
+	pixels = nullptr;
+	capacity = bucketCount = 0;
+	head = tail = none;
+}
+
+void GlyphCache::clear()
+{
+	if(entries == nullptr) {
+		return;
+	}
+
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		buckets[i] = none;
+	}
+
+	// All entries start off unused, in a chain from head to tail
+	for(unsigned i = 0; i < capacity; ++i) {
+		auto& entry = entries[i];
+		entry.used = false;
+		entry.chain = none;
+		entry.prev = (i == 0) ? none : i - 1;
+		entry.next = (i + 1 == capacity) ? none : i + 1;
+	}
+	head = 0;
+	tail = capacity - 1;
+}
+
+void GlyphCache::unlink(uint16_t index)
+{
+	auto& entry = entries[index];
+	if(entry.prev == none) {
+		head = entry.next;
+	} else {
+		entries[entry.prev].next = entry.next;
+	}
+	if(entry.next == none) {
+		tail = entry.prev;
+	} else {
+		entries[entry.next].prev = entry.prev;
+	}
+}
+
+void GlyphCache::pushFront(uint16_t index)
+{
+	auto& entry = entries[index];
+	entry.prev = none;
+	entry.next = head;
+	if(head == none) {
+		tail = index;
+	} else {
+		entries[head].prev = index;
+	}
+	head = index;
+}
+
+void GlyphCache::removeFromBucket(uint16_t index)
+{
+	auto& entry = entries[index];
+	auto link = &buckets[getBucket(entry.ch, entry.fore, entry.back)];
+	while(*link != none) {
+		if(*link == index) {
+			*link = entry.chain;
+			return;
+		}
+		link = &entries[*link].chain;
+	}
+}
+
+uint8_t* GlyphCache::find(uint8_t ch, uint16_t fore, uint16_t back)
+{
+	if(entries == nullptr) {
+		return nullptr;
+	}
+
+	for(auto index = buckets[getBucket(ch, fore, back)]; index != none; index = entries[index].chain) {
+		auto& entry = entries[index];
+		if(entry.ch == ch && entry.fore == fore && entry.back == back) {
+			if(index != head) {
+				unlink(index);
+				pushFront(index);
+			}
+			++hits;
+			return &pixels[index * glyphSize];
+		}
+	}
+
+	return nullptr;
+}
+
+uint8_t* GlyphCache::insert(uint8_t ch, uint16_t fore, uint16_t back)
+{
+	++misses;
+
+	auto index = tail;
+	auto& entry = entries[index];
+	if(entry.used) {
+		removeFromBucket(index);
+	}
+	unlink(index);
+	pushFront(index);
+
+	entry.ch = ch;
+	entry.fore = fore;
+	entry.back = back;
+	entry.used = true;
+	auto& bucket = buckets[getBucket(ch, fore, back)];
+	entry.chain = bucket;
+	bucket = index;
+
+	return &pixels[index * glyphSize];
+}
+
+} // namespace VT100
@@ -0,0 +1,70 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host builds are 32-bit, so large file support is needed for captures over 2GB
+#define _FILE_OFFSET_BITS 64
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/VT100/FileInput.h"
+
+namespace VT100
+{
+int64_t feedFile(Terminal& terminal, const char* filename, size_t windowSize)
+{
+	int fd = ::open(filename, O_RDONLY);
+	if(fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) < 0) {
+		::close(fd);
+		return -1;
+	}
+
+	// Windows must start on a page boundary
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	windowSize = std::max((windowSize / pageSize) * pageSize, pageSize);
+
+	uint64_t fileSize = st.st_size;
+	uint64_t offset = 0;
+	while(offset < fileSize) {
+		size_t length = std::min(uint64_t(windowSize), fileSize - offset);
+		void* window = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, off_t(offset));
+		if(window == MAP_FAILED) {
+			::close(fd);
+			return -1;
+		}
+		madvise(window, length, MADV_SEQUENTIAL);
+
+		// Sequences split between windows are carried over by the parser
+		terminal.nputs(static_cast<const char*>(window), length);
+
+		munmap(window, length);
+		offset += length;
+	}
+
+	::close(fd);
+	return offset;
+}
+
+} // namespace VT100
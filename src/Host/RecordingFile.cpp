@@ -0,0 +1,91 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host builds are 32-bit, so large file support is needed for recordings over 2GB
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../include/VT100/RecordingFile.h"
+
+namespace VT100
+{
+bool RecordingFileWriter::open(const char* filename, uint64_t offset)
+{
+	close();
+
+	if(offset == 0) {
+		file = fopen(filename, "wb");
+		return file != nullptr;
+	}
+
+	file = fopen(filename, "r+b");
+	if(file == nullptr) {
+		return false;
+	}
+	if(ftruncate(fileno(file), off_t(offset)) != 0 || fseeko(file, off_t(offset), SEEK_SET) != 0) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void RecordingFileWriter::close()
+{
+	if(file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+bool RecordingFileWriter::write(const void* data, size_t length)
+{
+	return file != nullptr && fwrite(data, 1, length, file) == length;
+}
+
+bool RecordingFileReader::open(const char* filename)
+{
+	close();
+
+	file = fopen(filename, "rb");
+	if(file == nullptr) {
+		return false;
+	}
+	if(fseeko(file, 0, SEEK_END) != 0) {
+		close();
+		return false;
+	}
+	size = ftello(file);
+	return true;
+}
+
+void RecordingFileReader::close()
+{
+	if(file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+	size = 0;
+}
+
+bool RecordingFileReader::read(uint64_t offset, void* buffer, size_t length)
+{
+	return file != nullptr && fseeko(file, off_t(offset), SEEK_SET) == 0 && fread(buffer, 1, length, file) == length;
+}
+
+} // namespace VT100
@@ -0,0 +1,117 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+
+#include "../include/VT100/SessionManager.h"
+
+namespace VT100
+{
+void Session::publish()
+{
+	auto& snapshot = snapshots.getWriteBuffer();
+	snapshot.cols = display.getColumnCount();
+	snapshot.rows = display.getRowCount();
+	size_t count = snapshot.cols * snapshot.rows;
+	snapshot.chars.assign(display.getChars(), display.getChars() + count);
+	snapshot.attrs.assign(display.getAttrs(), display.getAttrs() + count);
+	snapshot.bytesProcessed = getBytesProcessed();
+	snapshots.publish();
+}
+
+Session* SessionManager::createSession(uint16_t cols, uint16_t rows)
+{
+	std::unique_ptr<Session> session(new(std::nothrow) Session(cols, rows));
+	if(!session || !session->display.isAllocated()) {
+		return nullptr;
+	}
+	session->terminal.reset();
+
+	std::lock_guard<std::mutex> lock(sessionMutex);
+	sessions.push_back(std::move(session));
+	return sessions.back().get();
+}
+
+void SessionManager::write(Session& session, const char* data, size_t length)
+{
+	if(length == 0) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(session.inputMutex);
+		session.input.insert(session.input.end(), data, data + length);
+	}
+	if(!session.scheduled.exchange(true)) {
+		++busy;
+		schedule(session);
+	}
+}
+
+void SessionManager::schedule(Session& session)
+{
+	pool.submit([this, &session]() { process(session); });
+}
+
+// Runs on a worker thread. Only one worker has a given session at any time.
+void SessionManager::process(Session& session)
+{
+	{
+		std::lock_guard<std::mutex> lock(session.inputMutex);
+		std::swap(session.input, session.batch);
+	}
+
+	if(!session.batch.empty()) {
+		session.terminal.nputs(session.batch.data(), session.batch.size());
+		session.bytesProcessed += session.batch.size();
+		session.batch.clear();
+		session.publish();
+	}
+
+	/*
+	 * More input may have arrived while processing. Rather than loop, which would let one busy
+	 * session hold on to a worker, go behind the other sessions waiting for this worker.
+	 */
+	session.scheduled = false;
+	bool more;
+	{
+		std::lock_guard<std::mutex> lock(session.inputMutex);
+		more = !session.input.empty();
+	}
+	if(more && !session.scheduled.exchange(true)) {
+		pool.defer([this, &session]() { process(session); });
+		return;
+	}
+
+	// Either nothing to do, or a writer has scheduled the session again (and counted it as busy)
+	finished();
+}
+
+void SessionManager::finished()
+{
+	if(--busy == 0) {
+		std::lock_guard<std::mutex> lock(idleMutex);
+		idle.notify_all();
+	}
+}
+
+void SessionManager::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(idleMutex);
+	idle.wait(lock, [this]() { return busy == 0; });
+}
+
+} // namespace VT100
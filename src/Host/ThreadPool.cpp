@@ -0,0 +1,128 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "../include/VT100/ThreadPool.h"
+
+namespace VT100
+{
+namespace
+{
+// Identifies the pool and queue of the current worker thread, if any
+thread_local const void* currentPool;
+thread_local unsigned currentWorker;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	if(threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	for(unsigned i = 0; i < threadCount; ++i) {
+		workers.emplace_back(new Worker);
+	}
+	// Start threads once all queues exist, as any of them may be stolen from
+	for(unsigned i = 0; i < threadCount; ++i) {
+		workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(auto& worker : workers) {
+		worker->thread.join();
+	}
+}
+
+void ThreadPool::push(Task task, bool deferred)
+{
+	unsigned index = (currentPool == this) ? currentWorker : nextWorker++ % workers.size();
+	auto& worker = *workers[index];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		// The owner pops from the back, so the front is taken last
+		if(deferred) {
+			worker.tasks.push_front(std::move(task));
+		} else {
+			worker.tasks.push_back(std::move(task));
+		}
+	}
+	++queued;
+
+	// Taking the lock ensures a worker about to sleep sees the new task
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+bool ThreadPool::pop(unsigned index, Task& task)
+{
+	auto& worker = *workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if(worker.tasks.empty()) {
+		return false;
+	}
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	return true;
+}
+
+bool ThreadPool::steal(unsigned thief, Task& task)
+{
+	for(unsigned i = 1; i < workers.size(); ++i) {
+		auto& victim = *workers[(thief + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::run(unsigned index)
+{
+	currentPool = this;
+	currentWorker = index;
+
+	for(;;) {
+		Task task;
+		if(pop(index, task) || steal(index, task)) {
+			--queued;
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() { return stopping || queued != 0; });
+		if(stopping && queued == 0) {
+			return;
+		}
+	}
+}
+
+} // namespace VT100
@@ -0,0 +1,88 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+
+#include "include/VT100/InputRing.h"
+
+namespace VT100
+{
+bool InputRing::begin(size_t capacity)
+{
+	end();
+
+	size_t size = 16;
+	while(size < capacity) {
+		size <<= 1;
+	}
+	auto mem = new(std::nothrow) uint8_t[size];
+	if(mem == nullptr || !begin(mem, size)) {
+		delete[] mem;
+		return false;
+	}
+	ownBuffer = true;
+	return true;
+}
+
+bool InputRing::begin(uint8_t* buffer, size_t capacity)
+{
+	end();
+
+	if(buffer == nullptr || capacity < 16 || (capacity & (capacity - 1)) != 0) {
+		return false;
+	}
+	this->buffer = buffer;
+	mask = capacity - 1;
+	setWatermarks(capacity * 3 / 4, capacity / 4);
+	return true;
+}
+
+void InputRing::end()
+{
+	if(ownBuffer) {
+		delete[] buffer;
+		ownBuffer = false;
+	}
+	buffer = nullptr;
+	mask = 0;
+	head = tail = 0;
+	highCount = lowCount = 0;
+	overflowCount = peakLevel = 0;
+}
+
+void InputRing::setWatermarks(size_t high, size_t low, WatermarkCallback callback, void* param)
+{
+	highWatermark = high;
+	lowWatermark = (low < high) ? low : high;
+	this->callback = callback;
+	this->param = param;
+}
+
+void InputRing::consume(size_t length)
+{
+	uint32_t t = tail.load(std::memory_order_relaxed) + length;
+	tail.store(t, std::memory_order_release);
+
+	if(isThrottled() && head.load(std::memory_order_acquire) - t <= lowWatermark) {
+		lowCount.store(lowCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		if(callback != nullptr) {
+			callback(param, false);
+		}
+	}
+}
+
+} // namespace VT100
@@ -0,0 +1,258 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "include/VT100/Parser.h"
+
+/*
+ * The tables are generated at compile time from the rules below, which follow the
+ * VT500-series state diagram. Differences from the diagram:
+ *
+ * - C1 controls (0x80-0x9f) are not recognised; all bytes >= 0x80 are printed in ground state, as UTF-8
+ * - DEL is executed in ground state rather than ignored
+ * - BEL terminates OSC strings, as xterm does
+ */
+
+namespace VT100
+{
+namespace Parser
+{
+namespace
+{
+constexpr ByteClass byteClass(unsigned c)
+{
+	return (c == 0x07) ? BC_BEL
+		 : (c == 0x18 || c == 0x1a) ? BC_CANCEL
+		 : (c == 0x1b) ? BC_ESC
+		 : (c < 0x20) ? BC_C0
+		 : (c < 0x30) ? BC_INTER
+		 : (c < 0x3a) ? BC_DIGIT
+		 : (c == 0x3a) ? BC_COLON
+		 : (c == 0x3b) ? BC_SEMI
+		 : (c < 0x40) ? BC_PRIVATE
+		 : (c == 'P') ? BC_DCS
+		 : (c == 'X' || c == '^' || c == '_') ? BC_SOS
+		 : (c == '[') ? BC_CSI
+		 : (c == ']') ? BC_OSC
+		 : (c < 0x7f) ? BC_FINAL
+		 : (c == 0x7f) ? BC_DEL
+		 : BC_HIGH;
+}
+
+// 0x00-0x1f except CAN, SUB, ESC which are handled from any state
+constexpr bool isControl(ByteClass c)
+{
+	return c == BC_C0 || c == BC_BEL;
+}
+
+// 0x30-0x3f
+constexpr bool isParam(ByteClass c)
+{
+	return c == BC_DIGIT || c == BC_COLON || c == BC_SEMI || c == BC_PRIVATE;
+}
+
+// 0x40-0x7e
+constexpr bool isFinal(ByteClass c)
+{
+	return c == BC_FINAL || c == BC_DCS || c == BC_SOS || c == BC_CSI || c == BC_OSC;
+}
+
+constexpr uint8_t go(Action action, State next)
+{
+	return (uint8_t(action) << 4) | uint8_t(next);
+}
+
+constexpr uint8_t stay(Action action)
+{
+	return (uint8_t(action) << 4) | stateUnchanged;
+}
+
+constexpr uint8_t ground(ByteClass c)
+{
+	return (isControl(c) || c == BC_DEL) ? stay(Action::execute) : stay(Action::print);
+}
+
+constexpr uint8_t escape(ByteClass c)
+{
+	return isControl(c) ? stay(Action::execute)
+		 : (c == BC_INTER) ? go(Action::collect, State::escape_intermediate)
+		 : (c == BC_CSI) ? go(Action::none, State::csi_entry)
+		 : (c == BC_OSC) ? go(Action::none, State::osc_string)
+		 : (c == BC_DCS) ? go(Action::none, State::dcs_entry)
+		 : (c == BC_SOS) ? go(Action::none, State::sos_pm_apc_string)
+		 : (isParam(c) || isFinal(c)) ? go(Action::esc_dispatch, State::ground)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t escapeIntermediate(ByteClass c)
+{
+	return isControl(c) ? stay(Action::execute)
+		 : (c == BC_INTER) ? stay(Action::collect)
+		 : (isParam(c) || isFinal(c)) ? go(Action::esc_dispatch, State::ground)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t csiEntry(ByteClass c)
+{
+	return isControl(c) ? stay(Action::execute)
+		 : (c == BC_INTER) ? go(Action::collect, State::csi_intermediate)
+		 : (c == BC_COLON) ? go(Action::none, State::csi_ignore)
+		 : (c == BC_DIGIT || c == BC_SEMI) ? go(Action::param, State::csi_param)
+		 : (c == BC_PRIVATE) ? go(Action::collect, State::csi_param)
+		 : isFinal(c) ? go(Action::csi_dispatch, State::ground)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t csiParam(ByteClass c)
+{
+	return isControl(c) ? stay(Action::execute)
+		 : (c == BC_DIGIT || c == BC_SEMI) ? stay(Action::param)
+		 : (c == BC_COLON || c == BC_PRIVATE) ? go(Action::none, State::csi_ignore)
+		 : (c == BC_INTER) ? go(Action::collect, State::csi_intermediate)
+		 : isFinal(c) ? go(Action::csi_dispatch, State::ground)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t csiIntermediate(ByteClass c)
+{
+	return isControl(c) ? stay(Action::execute)
+		 : (c == BC_INTER) ? stay(Action::collect)
+		 : isParam(c) ? go(Action::none, State::csi_ignore)
+		 : isFinal(c) ? go(Action::csi_dispatch, State::ground)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t csiIgnore(ByteClass c)
+{
+	return isControl(c) ? stay(Action::execute) : isFinal(c) ? go(Action::none, State::ground) : stay(Action::none);
+}
+
+constexpr uint8_t dcsEntry(ByteClass c)
+{
+	return (c == BC_INTER) ? go(Action::collect, State::dcs_intermediate)
+		 : (c == BC_COLON) ? go(Action::none, State::dcs_ignore)
+		 : (c == BC_DIGIT || c == BC_SEMI) ? go(Action::param, State::dcs_param)
+		 : (c == BC_PRIVATE) ? go(Action::collect, State::dcs_param)
+		 : isFinal(c) ? go(Action::none, State::dcs_passthrough)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t dcsParam(ByteClass c)
+{
+	return (c == BC_DIGIT || c == BC_SEMI) ? stay(Action::param)
+		 : (c == BC_COLON || c == BC_PRIVATE) ? go(Action::none, State::dcs_ignore)
+		 : (c == BC_INTER) ? go(Action::collect, State::dcs_intermediate)
+		 : isFinal(c) ? go(Action::none, State::dcs_passthrough)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t dcsIntermediate(ByteClass c)
+{
+	return (c == BC_INTER) ? stay(Action::collect)
+		 : isParam(c) ? go(Action::none, State::dcs_ignore)
+		 : isFinal(c) ? go(Action::none, State::dcs_passthrough)
+		 : stay(Action::none);
+}
+
+constexpr uint8_t dcsPassthrough(ByteClass c)
+{
+	return (c == BC_DEL) ? stay(Action::none) : stay(Action::put);
+}
+
+constexpr uint8_t oscString(ByteClass c)
+{
+	return (c == BC_BEL) ? go(Action::none, State::ground)
+		 : (c == BC_C0) ? stay(Action::none)
+		 : stay(Action::osc_put);
+}
+
+constexpr uint8_t transition(State s, ByteClass c)
+{
+	return (c == BC_CANCEL) ? go(Action::execute, State::ground)
+		 : (c == BC_ESC) ? go(Action::none, State::escape)
+		 : (s == State::ground) ? ground(c)
+		 : (s == State::escape) ? escape(c)
+		 : (s == State::escape_intermediate) ? escapeIntermediate(c)
+		 : (s == State::csi_entry) ? csiEntry(c)
+		 : (s == State::csi_param) ? csiParam(c)
+		 : (s == State::csi_intermediate) ? csiIntermediate(c)
+		 : (s == State::csi_ignore) ? csiIgnore(c)
+		 : (s == State::dcs_entry) ? dcsEntry(c)
+		 : (s == State::dcs_param) ? dcsParam(c)
+		 : (s == State::dcs_intermediate) ? dcsIntermediate(c)
+		 : (s == State::dcs_passthrough) ? dcsPassthrough(c)
+		 : (s == State::osc_string) ? oscString(c)
+		 : stay(Action::none); // dcs_ignore, sos_pm_apc_string
+}
+
+constexpr Action entryAction(State s)
+{
+	return (s == State::escape || s == State::csi_entry || s == State::dcs_entry) ? Action::clear
+		 : (s == State::osc_string) ? Action::osc_start
+		 : (s == State::dcs_passthrough) ? Action::hook
+		 : Action::none;
+}
+
+constexpr Action exitAction(State s)
+{
+	return (s == State::osc_string) ? Action::osc_end : (s == State::dcs_passthrough) ? Action::unhook : Action::none;
+}
+
+} // namespace
+
+#define BC4(n) byteClass(n), byteClass(n + 1), byteClass(n + 2), byteClass(n + 3)
+#define BC16(n) BC4(n), BC4(n + 4), BC4(n + 8), BC4(n + 12)
+#define BC64(n) BC16(n), BC16(n + 16), BC16(n + 32), BC16(n + 48)
+
+constexpr uint8_t byteClasses[256] = {BC64(0x00), BC64(0x40), BC64(0x80), BC64(0xc0)};
+
+#undef BC64
+#undef BC16
+#undef BC4
+
+#define T4(s, n)                                                                                                       \
+	transition(s, ByteClass(n)), transition(s, ByteClass(n + 1)), transition(s, ByteClass(n + 2)),                     \
+		transition(s, ByteClass(n + 3))
+#define XX(s) {T4(State::s, 0), T4(State::s, 4), T4(State::s, 8), T4(State::s, 12)},
+
+static_assert(BC_COUNT == 16, "Table generator expects 16 byte classes");
+
+constexpr uint8_t transitions[stateCount][BC_COUNT] = {VT100_STATE_MAP(XX)};
+
+#undef XX
+#undef T4
+
+constexpr Action entryActions[stateCount] = {
+#define XX(s) entryAction(State::s),
+	VT100_STATE_MAP(XX)
+#undef XX
+};
+
+constexpr Action exitActions[stateCount] = {
+#define XX(s) exitAction(State::s),
+	VT100_STATE_MAP(XX)
+#undef XX
+};
+
+// Spot checks, evaluated by the compiler
+static_assert(byteClasses['7'] == BC_DIGIT && byteClasses['['] == BC_CSI && byteClasses[0xe2] == BC_HIGH, "byteClasses");
+static_assert(transitions[unsigned(State::ground)][BC_FINAL] == stay(Action::print), "transitions");
+static_assert(transitions[unsigned(State::csi_param)][BC_FINAL] == go(Action::csi_dispatch, State::ground),
+			  "transitions");
+static_assert(transitions[unsigned(State::osc_string)][BC_ESC] == go(Action::none, State::escape), "transitions");
+
+} // namespace Parser
+} // namespace VT100
@@ -0,0 +1,402 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+#include "include/VT100/Recording.h"
+
+namespace VT100
+{
+namespace
+{
+const uint32_t headerMagic = 0x31525456; // "VTR1"
+const uint32_t endMagic = 0x45525456;	// "VTRE"
+const size_t recordHeaderSize = 9;
+const size_t indexEntrySize = 12;
+const size_t endPayloadSize = 12;
+// Data is fed to the terminal in blocks of this size during playback
+const size_t playBlockSize = 256;
+
+void put16(uint8_t* p, uint16_t value)
+{
+	p[0] = value;
+	p[1] = value >> 8;
+}
+
+void put32(uint8_t* p, uint32_t value)
+{
+	put16(p, value);
+	put16(p + 2, value >> 16);
+}
+
+void put64(uint8_t* p, uint64_t value)
+{
+	put32(p, value);
+	put32(p + 4, value >> 32);
+}
+
+uint16_t get16(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+uint32_t get32(const uint8_t* p)
+{
+	return get16(p) | (uint32_t(get16(p + 2)) << 16);
+}
+
+uint64_t get64(const uint8_t* p)
+{
+	return get32(p) | (uint64_t(get32(p + 4)) << 32);
+}
+
+} // namespace
+
+/*
+ * Recorder
+ */
+
+bool Recorder::begin(RecordingOutput& output, uint32_t timestamp, const Player* existing)
+{
+	if(!terminal.isCellGridEnabled()) {
+		return false;
+	}
+
+	this->output = &output;
+	keyframeCount = 0;
+	bytesSinceKeyframe = 0;
+
+	if(existing != nullptr) {
+		if(existing->getColumnCount() != terminal.getColumnCount() ||
+		   existing->getRowCount() != terminal.getRowCount()) {
+			return false;
+		}
+		auto frames = existing->getKeyframes();
+		for(unsigned i = 0; i < existing->getKeyframeCount(); ++i) {
+			if(!addKeyframe(frames[i].timestamp, frames[i].offset)) {
+				return false;
+			}
+		}
+		offset = existing->getEndOffset();
+	} else {
+		offset = 0;
+		uint8_t header[8];
+		put32(&header[0], headerMagic);
+		put16(&header[4], terminal.getColumnCount());
+		put16(&header[6], terminal.getRowCount());
+		if(!writeRecord('H', timestamp, header, sizeof(header))) {
+			return false;
+		}
+	}
+
+	return keyframe(timestamp);
+}
+
+size_t Recorder::write(const char* data, size_t length, uint32_t timestamp)
+{
+	terminal.nputs(data, length);
+	if(output == nullptr || length == 0) {
+		return length;
+	}
+
+	if(!writeRecord('D', timestamp, data, length)) {
+		return 0;
+	}
+	bytesSinceKeyframe += length;
+	if(bytesSinceKeyframe >= keyframeInterval) {
+		keyframe(timestamp);
+	}
+	return length;
+}
+
+bool Recorder::keyframe(uint32_t timestamp)
+{
+	if(output == nullptr) {
+		return false;
+	}
+
+	size_t size = terminal.saveState(nullptr, 0);
+	auto snapshot = new(std::nothrow) uint8_t[size];
+	if(snapshot == nullptr) {
+		return false;
+	}
+	terminal.saveState(snapshot, size);
+	uint64_t recordOffset = offset;
+	bool ok = writeRecord('K', timestamp, snapshot, size) && addKeyframe(timestamp, recordOffset);
+	delete[] snapshot;
+
+	bytesSinceKeyframe = 0;
+	return ok;
+}
+
+bool Recorder::end(uint32_t timestamp)
+{
+	if(output == nullptr) {
+		return false;
+	}
+
+	// Index record, written piecemeal as it may be large
+	uint64_t indexOffset = offset;
+	uint8_t buffer[recordHeaderSize];
+	buffer[0] = 'I';
+	put32(&buffer[1], timestamp);
+	put32(&buffer[5], 4 + keyframeCount * indexEntrySize);
+	bool ok = output->write(buffer, recordHeaderSize);
+	put32(buffer, keyframeCount);
+	ok = ok && output->write(buffer, 4);
+	for(unsigned i = 0; ok && i < keyframeCount; ++i) {
+		uint8_t entry[indexEntrySize];
+		put32(&entry[0], keyframes[i].timestamp);
+		put64(&entry[4], keyframes[i].offset);
+		ok = output->write(entry, sizeof(entry));
+	}
+	offset += recordHeaderSize + 4 + keyframeCount * indexEntrySize;
+
+	uint8_t payload[endPayloadSize];
+	put32(&payload[0], endMagic);
+	put64(&payload[4], indexOffset);
+	ok = ok && writeRecord('E', timestamp, payload, sizeof(payload));
+
+	output = nullptr;
+	return ok;
+}
+
+bool Recorder::writeRecord(char type, uint32_t timestamp, const void* data, size_t length)
+{
+	uint8_t header[recordHeaderSize];
+	header[0] = type;
+	put32(&header[1], timestamp);
+	put32(&header[5], length);
+	offset += recordHeaderSize + length;
+	return output->write(header, sizeof(header)) && output->write(data, length);
+}
+
+bool Recorder::addKeyframe(uint32_t timestamp, uint64_t offset)
+{
+	if(keyframeCount == keyframeCapacity) {
+		unsigned capacity = keyframeCapacity ? keyframeCapacity * 2 : 16;
+		auto p = static_cast<Keyframe*>(realloc(keyframes, capacity * sizeof(Keyframe)));
+		if(p == nullptr) {
+			return false;
+		}
+		keyframes = p;
+		keyframeCapacity = capacity;
+	}
+	keyframes[keyframeCount++] = {timestamp, offset};
+	return true;
+}
+
+/*
+ * Player
+ */
+
+bool Player::begin(RecordingInput& input)
+{
+	end();
+	this->input = &input;
+
+	RecordHeader header;
+	uint8_t payload[8];
+	if(!readHeader(0, header) || header.type != 'H' || header.length != sizeof(payload) ||
+	   !input.read(recordHeaderSize, payload, sizeof(payload)) || get32(payload) != headerMagic) {
+		end();
+		return false;
+	}
+	cols = get16(&payload[4]);
+	rows = get16(&payload[6]);
+
+	if(!loadIndex() && !scan()) {
+		end();
+		return false;
+	}
+	position = 0;
+	return true;
+}
+
+void Player::end()
+{
+	free(keyframes);
+	keyframes = nullptr;
+	keyframeCount = 0;
+	input = nullptr;
+	endOffset = position = 0;
+	duration = 0;
+	cols = rows = 0;
+}
+
+bool Player::readHeader(uint64_t offset, RecordHeader& header)
+{
+	uint8_t buffer[recordHeaderSize];
+	if(offset + recordHeaderSize > input->getSize() || !input->read(offset, buffer, sizeof(buffer))) {
+		return false;
+	}
+	header.type = buffer[0];
+	header.timestamp = get32(&buffer[1]);
+	header.length = get32(&buffer[5]);
+	return true;
+}
+
+// Use the index of a closed recording
+bool Player::loadIndex()
+{
+	uint64_t size = input->getSize();
+	uint64_t endRecord = size - recordHeaderSize - endPayloadSize;
+	RecordHeader header;
+	uint8_t payload[endPayloadSize];
+	if(size < recordHeaderSize + endPayloadSize || !readHeader(endRecord, header) || header.type != 'E' ||
+	   header.length != endPayloadSize || !input->read(endRecord + recordHeaderSize, payload, sizeof(payload)) ||
+	   get32(payload) != endMagic) {
+		return false;
+	}
+	duration = header.timestamp;
+
+	// Offset and counts come from the file, so check the index fits before the end record
+	uint64_t indexOffset = get64(&payload[4]);
+	uint8_t count[4];
+	if(indexOffset > endRecord || !readHeader(indexOffset, header) || header.type != 'I' ||
+	   endRecord - indexOffset < recordHeaderSize + uint64_t(header.length) ||
+	   !input->read(indexOffset + recordHeaderSize, count, sizeof(count))) {
+		return false;
+	}
+	keyframeCount = get32(count);
+	uint64_t allocSize = uint64_t(keyframeCount) * sizeof(Keyframe);
+	if(header.length != 4 + uint64_t(keyframeCount) * indexEntrySize || allocSize > SIZE_MAX) {
+		keyframeCount = 0;
+		return false;
+	}
+	keyframes = static_cast<Keyframe*>(malloc(size_t(allocSize)));
+	if(keyframes == nullptr) {
+		keyframeCount = 0;
+		return false;
+	}
+	uint64_t pos = indexOffset + recordHeaderSize + 4;
+	for(unsigned i = 0; i < keyframeCount; ++i) {
+		uint8_t entry[indexEntrySize];
+		if(!input->read(pos, entry, sizeof(entry))) {
+			return false;
+		}
+		keyframes[i] = {get32(&entry[0]), get64(&entry[4])};
+		pos += indexEntrySize;
+	}
+
+	endOffset = size;
+	return true;
+}
+
+// Find keyframes by walking through every record, for a recording which wasn't closed
+bool Player::scan()
+{
+	free(keyframes);
+	keyframes = nullptr;
+	keyframeCount = 0;
+	unsigned capacity = 0;
+	duration = 0;
+
+	uint64_t size = input->getSize();
+	uint64_t pos = 0;
+	RecordHeader header;
+	while(readHeader(pos, header) && pos + recordHeaderSize + header.length <= size) {
+		if(header.type == 'K') {
+			if(keyframeCount == capacity) {
+				capacity = capacity ? capacity * 2 : 16;
+				auto p = static_cast<Keyframe*>(realloc(keyframes, capacity * sizeof(Keyframe)));
+				if(p == nullptr) {
+					return false;
+				}
+				keyframes = p;
+			}
+			keyframes[keyframeCount++] = {header.timestamp, pos};
+		}
+		duration = std::max(duration, header.timestamp);
+		pos += recordHeaderSize + header.length;
+	}
+
+	// Anything after this is a partly-written record
+	endOffset = pos;
+	return true;
+}
+
+bool Player::seek(Terminal& terminal, uint32_t timestamp)
+{
+	if(input == nullptr || !terminal.isCellGridEnabled() || terminal.getColumnCount() != cols ||
+	   terminal.getRowCount() != rows) {
+		return false;
+	}
+
+	// Last keyframe at or before the timestamp
+	auto next = std::upper_bound(keyframes, keyframes + keyframeCount, timestamp,
+								 [](uint32_t t, const Keyframe& keyframe) { return t < keyframe.timestamp; });
+	if(next == keyframes) {
+		// Before the first keyframe, so play from the start
+		terminal.reset();
+		position = 0;
+		return play(terminal, timestamp);
+	}
+
+	auto& keyframe = next[-1];
+	RecordHeader header;
+	if(!readHeader(keyframe.offset, header) || header.type != 'K') {
+		return false;
+	}
+	auto snapshot = new(std::nothrow) uint8_t[header.length];
+	if(snapshot == nullptr) {
+		return false;
+	}
+	bool ok = input->read(keyframe.offset + recordHeaderSize, snapshot, header.length) &&
+			  terminal.restoreState(snapshot, header.length);
+	delete[] snapshot;
+	if(!ok) {
+		return false;
+	}
+
+	position = keyframe.offset + recordHeaderSize + header.length;
+	return play(terminal, timestamp);
+}
+
+bool Player::play(Terminal& terminal, uint32_t timestamp)
+{
+	if(input == nullptr) {
+		return false;
+	}
+
+	RecordHeader header;
+	while(position < endOffset && readHeader(position, header)) {
+		if(header.timestamp > timestamp) {
+			return true;
+		}
+		uint64_t data = position + recordHeaderSize;
+		if(header.type == 'D') {
+			char buffer[playBlockSize];
+			for(uint32_t done = 0; done < header.length;) {
+				size_t n = std::min(size_t(header.length - done), sizeof(buffer));
+				if(!input->read(data + done, buffer, n)) {
+					return false;
+				}
+				terminal.nputs(buffer, n);
+				done += n;
+			}
+		}
+		position = data + header.length;
+	}
+	return position >= endOffset;
+}
+
+} // namespace VT100
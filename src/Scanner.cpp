@@ -0,0 +1,175 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+
+#include "include/VT100/Scanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VT100_SCAN_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VT100_SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VT100_SCAN_NEON
+#endif
+
+namespace VT100
+{
+namespace
+{
+inline bool isText(uint8_t c)
+{
+	return c >= 0x20 && c < 0x7f;
+}
+
+// Aligned word access which doesn't break strict aliasing rules
+using word_t = uintptr_t __attribute__((__may_alias__));
+
+const uintptr_t ones = ~uintptr_t(0) / 0xff;
+
+/*
+ * Set the top bit of every byte which is < 0x20, >= 0x7f.
+ * A borrow or carry only propagates out of a byte which is itself flagged.
+ */
+inline uintptr_t nonTextMask(uintptr_t x)
+{
+	return ((x - ones * 0x20) | x | (x + ones)) & (ones * 0x80);
+}
+
+#if defined(VT100_SCAN_SSE2) || defined(VT100_SCAN_AVX2)
+
+inline unsigned firstSet(unsigned mask)
+{
+	return __builtin_ctz(mask);
+}
+
+#endif
+
+} // namespace
+
+size_t scanTextScalar(const char* str, size_t length)
+{
+	size_t i = 0;
+	while(i < length && isText(str[i])) {
+		++i;
+	}
+	return i;
+}
+
+size_t scanTextSwar(const char* str, size_t length)
+{
+	auto p = reinterpret_cast<const uint8_t*>(str);
+	size_t i = 0;
+
+	// Get to an aligned word boundary, as MCUs fault on unaligned word loads
+	while(i < length && (uintptr_t(p + i) % sizeof(word_t)) != 0) {
+		if(!isText(p[i])) {
+			return i;
+		}
+		++i;
+	}
+
+	while(length - i >= sizeof(word_t)) {
+		auto x = *reinterpret_cast<const word_t*>(p + i);
+		if(nonTextMask(x) != 0) {
+			break;
+		}
+		i += sizeof(word_t);
+	}
+
+	return i + scanTextScalar(str + i, length - i);
+}
+
+#if defined(VT100_SCAN_AVX2)
+
+const char* const scanTextMethod = "AVX2";
+
+size_t scanText(const char* str, size_t length)
+{
+	const auto lower = _mm256_set1_epi8(0x1f);
+	const auto upper = _mm256_set1_epi8(0x7f);
+	size_t i = 0;
+	for(; length - i >= 32; i += 32) {
+		auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+		// Signed compare, so bytes >= 0x80 fail the first test
+		auto text = _mm256_and_si256(_mm256_cmpgt_epi8(v, lower), _mm256_cmpgt_epi8(upper, v));
+		unsigned mask = ~unsigned(_mm256_movemask_epi8(text));
+		if(mask != 0) {
+			return i + firstSet(mask);
+		}
+	}
+	return i + scanTextSwar(str + i, length - i);
+}
+
+#elif defined(VT100_SCAN_SSE2)
+
+const char* const scanTextMethod = "SSE2";
+
+size_t scanText(const char* str, size_t length)
+{
+	const auto lower = _mm_set1_epi8(0x1f);
+	const auto upper = _mm_set1_epi8(0x7f);
+	size_t i = 0;
+	for(; length - i >= 16; i += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+		// Signed compare, so bytes >= 0x80 fail the first test
+		auto text = _mm_and_si128(_mm_cmpgt_epi8(v, lower), _mm_cmplt_epi8(v, upper));
+		unsigned mask = ~unsigned(_mm_movemask_epi8(text)) & 0xffff;
+		if(mask != 0) {
+			return i + firstSet(mask);
+		}
+	}
+	return i + scanTextSwar(str + i, length - i);
+}
+
+#elif defined(VT100_SCAN_NEON)
+
+const char* const scanTextMethod = "NEON";
+
+size_t scanText(const char* str, size_t length)
+{
+	const auto lower = vdupq_n_u8(0x20);
+	const auto upper = vdupq_n_u8(0x7f);
+	size_t i = 0;
+	for(; length - i >= 16; i += 16) {
+		auto v = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+		auto nonText = vorrq_u8(vcltq_u8(v, lower), vcgeq_u8(v, upper));
+		// Narrow to one nibble per byte so the result fits in 64 bits
+		auto nibbles = vshrn_n_u16(vreinterpretq_u16_u8(nonText), 4);
+		uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+		if(mask != 0) {
+			return i + (__builtin_ctzll(mask) / 4);
+		}
+	}
+	return i + scanTextSwar(str + i, length - i);
+}
+
+#else
+
+const char* const scanTextMethod = "SWAR";
+
+size_t scanText(const char* str, size_t length)
+{
+	return scanTextSwar(str, length);
+}
+
+#endif
+
+} // namespace VT100
@@ -0,0 +1,197 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+
+#include "include/VT100/Scrollback.h"
+
+namespace VT100
+{
+namespace
+{
+const unsigned maxRunLength = 0x7f;
+const uint8_t styleFollows = 0x80;
+
+// Size of the length fields at each end of a record
+const unsigned recordOverhead = 4;
+
+const Scrollback::Allocator defaultAllocator = {malloc, free};
+
+} // namespace
+
+bool Scrollback::begin(size_t capacity, const Allocator* allocator)
+{
+	end();
+
+	this->allocator = allocator ? allocator : &defaultAllocator;
+	buffer = static_cast<uint8_t*>(this->allocator->allocate(capacity));
+	if(buffer == nullptr) {
+		return false;
+	}
+	this->capacity = capacity;
+	clear();
+	return true;
+}
+
+void Scrollback::end()
+{
+	if(buffer != nullptr) {
+		allocator->release(buffer);
+		buffer = nullptr;
+	}
+	capacity = 0;
+	clear();
+}
+
+void Scrollback::clear()
+{
+	head = tail = wrapEnd = 0;
+	wrapped = false;
+	lineCount = 0;
+}
+
+uint8_t* Scrollback::writeStyle(uint8_t* p, const Style& style)
+{
+	*p++ = style.fore;
+	*p++ = style.fore >> 8;
+	*p++ = style.back;
+	*p++ = style.back >> 8;
+	*p++ = style.flags;
+	return p;
+}
+
+void Scrollback::push(const Cell* cells, uint16_t count, const StyleTable& styles, const CharTable& chars)
+{
+	if(buffer == nullptr) {
+		return;
+	}
+
+	// Trailing blanks which look the same as cleared cells aren't stored
+	while(count > 0 && cells[count - 1].ch == ' ' && styles[cells[count - 1].attr].getEraseStyle() == defaultStyle) {
+		--count;
+	}
+
+	// Runs are broken at every attribute change, or when they get too long
+	auto getRunLength = [&](unsigned col) -> unsigned {
+		unsigned n = 1;
+		while(col + n < count && n < maxRunLength && cells[col + n].attr == cells[col].attr) {
+			++n;
+		}
+		return n;
+	};
+
+	size_t size = 0;
+	Style style = defaultStyle;
+	for(unsigned col = 0; col < count;) {
+		auto n = getRunLength(col);
+		auto& runStyle = styles[cells[col].attr];
+		size += 1 + n;
+		if(runStyle != style) {
+			size += styleSize;
+			style = runStyle;
+		}
+		col += n;
+	}
+
+	if(size > 0xffff || size + recordOverhead > capacity) {
+		return;
+	}
+
+	auto pos = reserve(size + recordOverhead);
+	writeSize(pos, size);
+	writeSize(pos + 2 + size, size);
+
+	auto p = &buffer[pos + 2];
+	style = defaultStyle;
+	for(unsigned col = 0; col < count;) {
+		auto n = getRunLength(col);
+		auto& runStyle = styles[cells[col].attr];
+		if(runStyle != style) {
+			*p++ = n | styleFollows;
+			p = writeStyle(p, runStyle);
+			style = runStyle;
+		} else {
+			*p++ = n;
+		}
+		for(unsigned i = 0; i < n; ++i) {
+			*p++ = chars.getGlyph(cells[col + i].ch);
+		}
+		col += n;
+	}
+}
+
+size_t Scrollback::reserve(size_t size)
+{
+	for(;;) {
+		if(lineCount == 0) {
+			clear();
+		}
+
+		if(!wrapped) {
+			if(capacity - head >= size) {
+				break;
+			}
+			// Continue from start of buffer
+			wrapEnd = head;
+			head = 0;
+			wrapped = true;
+			continue;
+		}
+
+		if(tail - head >= size) {
+			break;
+		}
+		discardOldest();
+	}
+
+	auto pos = head;
+	head += size;
+	++lineCount;
+	return pos;
+}
+
+void Scrollback::discardOldest()
+{
+	tail += readSize(tail) + recordOverhead;
+	--lineCount;
+	if(wrapped && tail == wrapEnd) {
+		tail = 0;
+		wrapped = false;
+	}
+}
+
+bool Scrollback::getLine(unsigned index, Line& line) const
+{
+	if(index >= lineCount) {
+		return false;
+	}
+
+	size_t pos = head;
+	for(unsigned i = 0;; ++i) {
+		if(pos == 0) {
+			pos = wrapEnd;
+		}
+		auto size = readSize(pos - 2);
+		pos -= size + recordOverhead;
+		if(i == index) {
+			line = {&buffer[pos + 2], size};
+			return true;
+		}
+	}
+}
+
+} // namespace VT100
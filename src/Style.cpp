@@ -0,0 +1,251 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+
+#include "include/VT100/Style.h"
+
+namespace VT100
+{
+namespace
+{
+const uint16_t ansiColors[] = {
+	// normal
+	0x0000, // black
+	0xf800, // red
+	0x0780, // green
+	0xfe00, // yellow
+	0x001f, // blue
+	0xf81f, // magenta
+	0x07ff, // cyan
+	0xffff, // white
+	// bright
+	0x7bef, // grey
+	0xfb2c, // red
+	0x87f0, // green
+	0xfff0, // yellow
+	0x841f, // blue
+	0xfc1f, // magenta
+	0x87ff, // cyan
+	0xffff, // white
+};
+
+// Halve intensity of an RGB565 colour
+uint16_t dimColor(uint16_t color)
+{
+	return (color >> 1) & 0x7bef;
+}
+
+} // namespace
+
+uint16_t getPaletteColor(uint8_t index)
+{
+	if(index < 16) {
+		return ansiColors[index];
+	}
+
+	if(index < 232) {
+		static const uint8_t levels[] = {0, 95, 135, 175, 215, 255};
+		index -= 16;
+		return rgb565(levels[index / 36], levels[(index / 6) % 6], levels[index % 6]);
+	}
+
+	uint8_t level = 8 + (index - 232) * 10;
+	return rgb565(level, level, level);
+}
+
+CellAttr Style::resolve() const
+{
+	uint16_t f;
+	if(flags & foreRgb) {
+		f = fore;
+	} else {
+		// bold selects the bright variant of the basic colours
+		auto index = ((flags & bold) && fore < 8) ? fore + 8 : fore;
+		f = getPaletteColor(index);
+	}
+	if(flags & dim) {
+		f = dimColor(f);
+	}
+
+	uint16_t b = (flags & backRgb) ? back : getPaletteColor(back);
+
+	if(flags & reverse) {
+		return {b, f};
+	}
+	if(flags & conceal) {
+		return {b, b};
+	}
+	return {f, b};
+}
+
+Style Style::getEraseStyle() const
+{
+	Style style = defaultStyle;
+	if(flags & reverse) {
+		style.setBack(fore, flags & foreRgb);
+	} else {
+		style.setBack(back, flags & backRgb);
+	}
+	return style;
+}
+
+void Style::applySgr(const uint16_t* params, unsigned count)
+{
+	// [m means reset the attributes to default
+	if(count == 0) {
+		*this = defaultStyle;
+		return;
+	}
+
+	for(unsigned i = 0; i < count; ++i) {
+		auto n = params[i];
+		switch(n) {
+		case 0: // all attributes off
+			*this = defaultStyle;
+			break;
+		case 1:
+			flags |= bold;
+			break;
+		case 2:
+			flags |= dim;
+			break;
+		case 4:
+		case 21: // double underline
+			flags |= underline;
+			break;
+		case 5: // slow blink
+		case 6: // rapid blink
+			flags |= blink;
+			break;
+		case 7:
+			flags |= reverse;
+			break;
+		case 8:
+			flags |= conceal;
+			break;
+		case 22: // normal intensity
+			flags &= ~(bold | dim);
+			break;
+		case 24:
+			flags &= ~underline;
+			break;
+		case 25:
+			flags &= ~blink;
+			break;
+		case 27:
+			flags &= ~reverse;
+			break;
+		case 28:
+			flags &= ~conceal;
+			break;
+		case 39: // default foreground
+			setFore(white, false);
+			break;
+		case 49: // default background
+			setBack(black, false);
+			break;
+
+		// extended colours: 5;n for 256 colours, 2;r;g;b for truecolour
+		case 38:
+		case 48: {
+			uint16_t color;
+			bool rgb;
+			if(i + 2 < count && params[i + 1] == 5) {
+				color = params[i + 2] & 0xff;
+				rgb = false;
+				i += 2;
+			} else if(i + 4 < count && params[i + 1] == 2) {
+				color = rgb565(params[i + 2], params[i + 3], params[i + 4]);
+				rgb = true;
+				i += 4;
+			} else {
+				// malformed, ignore the rest
+				return;
+			}
+			if(n == 38) {
+				setFore(color, rgb);
+			} else {
+				setBack(color, rgb);
+			}
+			break;
+		}
+
+		default:
+			if(n >= 30 && n < 38) {
+				setFore(n - 30, false);
+			} else if(n >= 40 && n < 48) {
+				setBack(n - 40, false);
+			} else if(n >= 90 && n < 98) {
+				setFore(n - 90 + 8, false);
+			} else if(n >= 100 && n < 108) {
+				setBack(n - 100 + 8, false);
+			}
+			// italic, fonts, etc. not supported
+		}
+	}
+}
+
+void StyleTable::reset()
+{
+	memset(allocated, 0, sizeof(allocated));
+	styles[0] = defaultStyle;
+	mark(allocated, 0);
+}
+
+uint8_t StyleTable::intern(const Style& style)
+{
+	int freeSlot = -1;
+	for(unsigned id = 0; id < maxStyles; ++id) {
+		if(!isMarked(allocated, id)) {
+			if(freeSlot < 0) {
+				freeSlot = id;
+			}
+		} else if(styles[id] == style) {
+			return id;
+		}
+	}
+
+	if(freeSlot < 0) {
+		return invalid;
+	}
+
+	styles[freeSlot] = style;
+	mark(allocated, freeSlot);
+	return freeSlot;
+}
+
+void StyleTable::collect(const uint32_t* used)
+{
+	for(unsigned i = 0; i < bitmapWords; ++i) {
+		allocated[i] &= used[i];
+	}
+	mark(allocated, 0);
+}
+
+unsigned StyleTable::count() const
+{
+	unsigned n = 0;
+	for(unsigned id = 0; id < maxStyles; ++id) {
+		if(isMarked(allocated, id)) {
+			++n;
+		}
+	}
+	return n;
+}
+
+} // namespace VT100
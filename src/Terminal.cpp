@@ -17,25 +17,24 @@
 	Copyright: Martin K. Schröder (info@fortmax.se) 2014
 */
 
-#include <cctype>
 #include <cstring>
 #include <cstdlib>
-#include <stringutil.h>
-#include <m_printf.h>
+#include <algorithm>
 
 #include "include/VT100/Terminal.h"
+#include "include/VT100/Scanner.h"
+#include "include/VT100/Format.h"
 
-#define KEY_ESC 0x1b
 #define KEY_DEL 0x7f
 #define KEY_BELL 0x07
 
 namespace VT100
 {
-const Terminal::StateMethod Terminal::stateTable[] = {
-#define XX(s) &Terminal::state_##s,
-	VT100_STATE_MAP(XX)
-#undef XX
-};
+namespace
+{
+const Cell blankCell = {' ', 0};
+
+} // namespace
 
 void Terminal::reset()
 {
@@ -43,19 +42,382 @@ void Terminal::reset()
 	charWidth = display.getCharWidth();
 	screenWidth = display.getWidth();
 	screenHeight = display.getHeight();
-	rowCount = screenHeight / charHeight;
-	colCount = screenWidth / charWidth;
-	backColor = 0x0000;
-	frontColor = 0xffff;
+	rowCount = (fixedRowCount != 0) ? fixedRowCount : screenHeight / charHeight;
+	colCount = (fixedColCount != 0) ? fixedColCount : screenWidth / charWidth;
+	style = defaultStyle;
+	attr = 0;
 	cursorPos = {};
 	savedCursorPos = {};
 	args = {};
-	state = State::idle;
-	ret_state = State::idle;
+	state = State::ground;
+	utf8.reset();
 	resetScroll();
 	flags.val = 0;
-	display.setFrontColor(frontColor);
-	display.setBackColor(backColor);
+	display.setFrontColor(style.resolve().frontColor);
+	display.setBackColor(style.resolve().backColor);
+	VT100_STATS(stats.displayCalls.setColor += 2);
+	if(gridEnabled) {
+		initGrid();
+	}
+}
+
+void Terminal::setFixedSize(uint16_t cols, uint16_t rows, Cell* cells, CellGrid::Span* dirty)
+{
+	fixedColCount = cols;
+	fixedRowCount = rows;
+	if(cells != nullptr) {
+		grid.setStorage(cells, dirty, cols, rows);
+	}
+}
+
+bool Terminal::enableCellGrid(bool enable)
+{
+	if(!enable) {
+		// draw anything outstanding before the grid goes
+		flush();
+		gridEnabled = false;
+		grid.free();
+		frameInterval = 0;
+		return true;
+	}
+
+	gridEnabled = true;
+
+	// Otherwise grid gets allocated on reset()
+	if(colCount != 0) {
+		initGrid();
+	}
+
+	return gridEnabled;
+}
+
+void Terminal::initGrid()
+{
+	if(!grid.resize(colCount, rowCount)) {
+		gridEnabled = false;
+		frameInterval = 0;
+		return;
+	}
+
+	// We don't know what's on the display so redraw everything
+	for(unsigned row = 0; row < rowCount; ++row) {
+		grid.reset(row, blankCell);
+	}
+	pendingScroll.lines = 0;
+
+	styles.reset();
+	chars.reset(display.mapCodepoint(Utf8Decoder::replacement));
+	attr = getStyleId(style);
+}
+
+void Terminal::setStyle(const Style& newStyle)
+{
+	style = newStyle;
+	if(gridEnabled) {
+		attr = getStyleId(style);
+	}
+}
+
+Attr Terminal::getStyleId(const Style& style)
+{
+	auto id = styles.intern(style);
+	if(id == StyleTable::invalid) {
+		collectStyles();
+		id = styles.intern(style);
+	}
+
+	// Out of styles, so fall back to the default
+	return (id == StyleTable::invalid) ? 0 : id;
+}
+
+// release styles which are no longer used on screen
+void Terminal::collectStyles()
+{
+	uint32_t used[StyleTable::bitmapWords] = {};
+	StyleTable::mark(used, attr);
+	for(unsigned row = 0; row < rowCount; ++row) {
+		auto cells = grid.row(row);
+		for(unsigned col = 0; col < colCount; ++col) {
+			StyleTable::mark(used, cells[col].attr);
+		}
+	}
+	styles.collect(used);
+}
+
+uint8_t Terminal::getCharId(uint32_t codepoint)
+{
+	auto id = chars.intern(codepoint, display.mapCodepoint(codepoint));
+	if(id == CharTable::invalid) {
+		collectChars();
+		id = chars.intern(codepoint, display.mapCodepoint(codepoint));
+	}
+
+	// Out of characters, so fall back to the replacement character
+	return (id == CharTable::invalid) ? CharTable::firstId : id;
+}
+
+// release characters which are no longer used on screen
+void Terminal::collectChars()
+{
+	uint32_t used[CharTable::bitmapWords] = {};
+	for(unsigned row = 0; row < rowCount; ++row) {
+		auto cells = grid.row(row);
+		for(unsigned col = 0; col < colCount; ++col) {
+			CharTable::mark(used, cells[col].ch);
+		}
+	}
+	chars.collect(used);
+}
+
+void Terminal::flush()
+{
+	if(!gridEnabled) {
+		return;
+	}
+
+	// New output returns the view to the live screen
+	if(viewOffset != 0) {
+		if(!grid.isDirty()) {
+			return;
+		}
+		resetView();
+	}
+
+	applyScroll();
+
+	for(unsigned row = 0; row < rowCount; ++row) {
+		auto span = grid.getDirty(row);
+		if(span.empty()) {
+			continue;
+		}
+		grid.clearDirty(row);
+		drawCells(row, span.start, span.end, row);
+	}
+}
+
+// get number of blank cells with the same attribute starting at col
+unsigned Terminal::getBlankRun(uint16_t row, uint16_t col, uint16_t endCol)
+{
+	auto cells = grid.row(row);
+	// a fill can't draw the underline, so underlined spaces are drawn as text
+	if(col < endCol && (styles[cells[col].attr].flags & Style::underline)) {
+		return 0;
+	}
+	unsigned n = 0;
+	while(col + n < endCol && cells[col + n].ch == ' ' && cells[col + n].attr == cells[col].attr) {
+		++n;
+	}
+	return n;
+}
+
+// draw a range of cells from the grid, using fillRect for longer stretches of blank cells
+void Terminal::drawCells(uint16_t row, uint16_t col, uint16_t endCol, uint16_t screenRow)
+{
+	const unsigned minFillRun = 4;
+
+	auto cells = grid.row(row);
+	uint16_t y = screenRow * charHeight;
+
+	while(col < endCol) {
+		auto blank = getBlankRun(row, col, endCol);
+		if(blank >= minFillRun || col + blank == endCol) {
+			auto color = styles[cells[col].attr].resolve().backColor;
+			fillRect(col * charWidth, y, blank * charWidth, charHeight, color);
+			col += blank;
+			continue;
+		}
+
+		// Text up to the next blank run long enough to fill
+		unsigned end = col + blank;
+		while(end < endCol) {
+			auto n = getBlankRun(row, end, endCol);
+			if(n >= minFillRun || end + n == endCol) {
+				break;
+			}
+			end += std::max(n, 1U);
+		}
+
+		uint8_t glyphs[32];
+		CellAttr attrs[32];
+		while(col < end) {
+			unsigned n = std::min(end - col, unsigned(sizeof(glyphs)));
+			int lastAttr = -1;
+			bool underline = false;
+			for(unsigned i = 0; i < n; ++i) {
+				auto& cell = cells[col + i];
+				glyphs[i] = chars.getGlyph(cell.ch);
+				if(cell.attr == lastAttr) {
+					attrs[i] = attrs[i - 1];
+					continue;
+				}
+				auto& cellStyle = styles[cell.attr];
+				attrs[i] = cellStyle.resolve();
+				lastAttr = cell.attr;
+				if(cellStyle.flags & Style::underline) {
+					underline = true;
+				}
+			}
+			display.drawCells(col * charWidth, y, glyphs, attrs, n);
+			VT100_STATS(++stats.displayCalls.drawCells);
+
+			if(underline) {
+				for(unsigned i = 0; i < n; ++i) {
+					if(styles[cells[col + i].attr].flags & Style::underline) {
+						drawUnderline(col + i, screenRow, 1, attrs[i].frontColor);
+					}
+				}
+			}
+
+			col += n;
+		}
+	}
+}
+
+bool Terminal::enableFramePacing(unsigned maxFrameRate)
+{
+	if(maxFrameRate == 0) {
+		frameInterval = 0;
+		flush();
+		return true;
+	}
+
+	if(!gridEnabled && !enableCellGrid(true)) {
+		return false;
+	}
+	frameInterval = std::max(1000U / maxFrameRate, 1U);
+	return true;
+}
+
+bool Terminal::isFramePending() const
+{
+	return gridEnabled && grid.isDirty();
+}
+
+bool Terminal::present(uint32_t now)
+{
+	if(!isFramePending() || int32_t(now - getNextFrameTime()) < 0) {
+		return false;
+	}
+	flush();
+	lastFrameTime = now;
+	return true;
+}
+
+bool Terminal::enableScrollback(size_t size, const Scrollback::Allocator* allocator)
+{
+	resetView();
+	if(size == 0) {
+		scrollback.end();
+		return true;
+	}
+	return scrollback.begin(size, allocator);
+}
+
+unsigned Terminal::scrollView(int lines)
+{
+	if(!gridEnabled) {
+		return 0;
+	}
+
+	flush();
+
+	int offset = std::max(0, std::min(int(viewOffset) + lines, int(scrollback.getLineCount())));
+	int diff = offset - viewOffset;
+	if(diff == 0) {
+		return viewOffset;
+	}
+	viewOffset = offset;
+
+	// Move what's already on screen, then draw the rest
+	uint16_t start = 0;
+	uint16_t end = rowCount;
+	if(abs(diff) < rowCount) {
+		display.scroll(0, (rowCount * charHeight) - 1, -diff * charHeight);
+		VT100_STATS(++stats.displayCalls.scroll);
+		if(diff > 0) {
+			end = diff;
+		} else {
+			start = rowCount + diff;
+		}
+	}
+	for(unsigned row = start; row < end; ++row) {
+		drawViewRow(row);
+	}
+
+	return viewOffset;
+}
+
+void Terminal::resetView()
+{
+	if(viewOffset != 0) {
+		viewOffset = 0;
+		grid.invalidate();
+		// everything gets redrawn, so moving display content is pointless
+		pendingScroll.lines = 0;
+	}
+}
+
+void Terminal::drawViewRow(uint16_t row)
+{
+	if(row >= viewOffset) {
+		drawCells(row - viewOffset, 0, colCount, row);
+		return;
+	}
+
+	Scrollback::Line line;
+	if(!scrollback.getLine(viewOffset - 1 - row, line)) {
+		return;
+	}
+
+	uint16_t y = row * charHeight;
+	unsigned width = line.forEachRun([&](unsigned col, const char* chars, unsigned count, const Style& runStyle) {
+		CellAttr attrs[32];
+		auto attr = runStyle.resolve();
+		for(auto& a : attrs) {
+			a = attr;
+		}
+		count = std::min(count, unsigned(std::max(int(colCount) - int(col), 0)));
+		while(count != 0) {
+			auto n = std::min(count, unsigned(sizeof(attrs) / sizeof(attrs[0])));
+			display.drawCells(col * charWidth, y, reinterpret_cast<const uint8_t*>(chars), attrs, n);
+			VT100_STATS(++stats.displayCalls.drawCells);
+			chars += n;
+			col += n;
+			count -= n;
+		}
+	});
+
+	if(width < colCount) {
+		auto color = defaultStyle.resolve().backColor;
+		fillRect(width * charWidth, y, (colCount - width) * charWidth, charHeight, color);
+	}
+}
+
+void Terminal::drawUnderline(uint16_t col, uint16_t row, uint16_t count, uint16_t color)
+{
+	// a one-pixel line would cover characters which are only one unit high
+	if(charHeight < 2) {
+		return;
+	}
+	fillRect(col * charWidth, (row + 1) * charHeight - 1, count * charWidth, 1, color);
+}
+
+void Terminal::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+	display.fillRect(x, y, w, h, color);
+	VT100_STATS(++stats.displayCalls.fillRect);
+	VT100_STATS(stats.pixelsFilled += w * h);
+}
+
+// copy lines about to scroll off the top of the screen into scrollback
+void Terminal::saveLines(uint16_t count)
+{
+	if(!scrollback.isEnabled()) {
+		return;
+	}
+	for(unsigned row = 0; row < count; ++row) {
+		scrollback.push(grid.row(row), colCount, styles, chars);
+	}
 }
 
 void Terminal::resetScroll()
@@ -66,12 +428,22 @@ void Terminal::resetScroll()
 
 void Terminal::clearLines(uint16_t start_line, uint16_t end_line)
 {
-	for(int c = start_line; c <= end_line; c++) {
-		uint16_t cy = cursorPos.row;
-		cursorPos.row = c;
-		display.fillRect(0, cursorPos.row * charHeight, screenWidth, charHeight, 0x0000);
-		cursorPos.row = cy;
+	end_line = std::min(end_line, uint16_t(rowCount - 1));
+	if(start_line > end_line) {
+		return;
+	}
+
+	VT100_STATS(stats.linesCleared += 1 + end_line - start_line);
+
+	if(gridEnabled) {
+		for(unsigned row = start_line; row <= end_line; ++row) {
+			grid.fill(row, 0, colCount, blankCell);
+		}
+		return;
 	}
+
+	// lines are contiguous so clear them in one go
+	fillRect(0, start_line * charHeight, screenWidth, (1 + end_line - start_line) * charHeight, 0x0000);
 }
 
 // moves the cursor relative to current cursor position and scrolls the screen
@@ -106,16 +478,137 @@ void Terminal::move(int16_t right_left, int16_t bottom_top)
 			return;
 		}
 
+		// lines leaving the top of the screen go into scrollback
+		int lines = new_y - cursorPos.row;
+		if(gridEnabled && lines > 0 && scrollStartRow == 0) {
+			saveLines(std::min(lines, scrollEndRow + 1));
+		}
+
 		// scrolls the scroll region up (lines > 0) or down (lines < 0)
-		auto lines = new_y - cursorPos.row;
-		display.scroll(scrollStartRow * charHeight, ((1 + scrollEndRow) * charHeight) - 1, lines * charHeight);
+		scrollRegion(scrollStartRow, scrollEndRow, lines);
+	}
+}
 
-		// clearing of lines that we have scrolled up or down
-		if(lines > 0) {
-			clearLines(1 + scrollEndRow - lines, scrollEndRow);
-		} else {
-			clearLines(scrollStartRow, scrollStartRow - lines - 1);
+// scrolls rows top to bottom up (lines > 0) or down (lines < 0), clearing the exposed lines
+void Terminal::scrollRegion(uint16_t top, uint16_t bottom, int lines)
+{
+	bottom = std::min(bottom, uint16_t(rowCount - 1));
+	if(top > bottom) {
+		return;
+	}
+	lines = std::max(std::min(lines, bottom + 1 - top), top - bottom - 1);
+	VT100_STATS(++stats.scrolls);
+
+	if(gridEnabled) {
+		resetView();
+		/*
+		 * The display gets scrolled when the grid is next drawn. Dirty spans move with their rows,
+		 * so repeated scrolls of the same region add up to one display scroll.
+		 */
+		if(pendingScroll.lines != 0 && (top != pendingScroll.top || bottom != pendingScroll.bottom)) {
+			applyScroll();
 		}
+		grid.scroll(top, bottom, lines, blankCell);
+		int height = bottom + 1 - top;
+		pendingScroll.top = top;
+		pendingScroll.bottom = bottom;
+		pendingScroll.lines = std::max(std::min(pendingScroll.lines + lines, height), -height);
+		return;
+	}
+
+	display.scroll(top * charHeight, ((1 + bottom) * charHeight) - 1, lines * charHeight);
+	VT100_STATS(++stats.displayCalls.scroll);
+
+	// clearing of lines that we have scrolled up or down
+	if(lines > 0) {
+		clearLines(1 + bottom - lines, bottom);
+	} else {
+		clearLines(top, top - lines - 1);
+	}
+}
+
+// scroll display to match the grid, clearing the exposed lines
+void Terminal::applyScroll()
+{
+	int lines = pendingScroll.lines;
+	if(lines == 0) {
+		return;
+	}
+	pendingScroll.lines = 0;
+
+	auto top = pendingScroll.top;
+	auto bottom = std::min(pendingScroll.bottom, uint16_t(rowCount - 1));
+	if(top > bottom) {
+		return;
+	}
+	unsigned count = std::min(unsigned(abs(lines)), unsigned(bottom + 1 - top));
+	if(count <= unsigned(bottom - top)) {
+		display.scroll(top * charHeight, ((1 + bottom) * charHeight) - 1, lines * charHeight);
+		VT100_STATS(++stats.displayCalls.scroll);
+	}
+
+	// One fill covers all the exposed lines
+	uint16_t first = (lines > 0) ? (1 + bottom - count) : top;
+	auto color = styles[blankCell.attr].resolve().backColor;
+	fillRect(0, first * charHeight, screenWidth, count * charHeight, color);
+
+	// Rows which are still blank don't need drawing again
+	for(unsigned row = first; row < first + count; ++row) {
+		auto cells = grid.row(row);
+		unsigned col = 0;
+		while(col < colCount && cells[col] == blankCell) {
+			++col;
+		}
+		if(col == colCount) {
+			grid.clearDirty(row);
+		}
+	}
+}
+
+// inserts (count > 0) or deletes (count < 0) characters at the cursor, shifting the rest of the line
+void Terminal::shiftChars(int count)
+{
+	uint16_t row = cursorPos.row;
+	uint16_t col = std::min(cursorPos.col, uint16_t(colCount - 1));
+	unsigned n = std::min(unsigned(abs(count)), unsigned(colCount - col));
+	// cells which stay on the line, and where they move from and to
+	unsigned moved = colCount - col - n;
+	uint16_t srcCol = (count > 0) ? col : col + n;
+	uint16_t dstCol = (count > 0) ? col + n : col;
+	// cells which become blank
+	uint16_t blankCol = (count > 0) ? col : colCount - n;
+	uint16_t y = row * charHeight;
+	auto eraseStyle = style.getEraseStyle();
+
+	auto copy = [&]() -> bool {
+		if(moved == 0) {
+			return false;
+		}
+		VT100_STATS(++stats.displayCalls.copyRect);
+		return display.copyRect(srcCol * charWidth, y, moved * charWidth, charHeight, dstCol * charWidth, y);
+	};
+
+	if(gridEnabled) {
+		// display content can only be moved if it's current
+		bool live = !isFramePaced() && viewOffset == 0;
+		if(live) {
+			flush();
+		}
+		grid.shift(row, col, (count > 0) ? n : -n, Cell{' ', getStyleId(eraseStyle)});
+		if(live && copy()) {
+			// only the vacated cells need drawing
+			grid.clearDirty(row);
+			grid.markDirty(row, blankCol, blankCol + n);
+		}
+		return;
+	}
+
+	auto backColor = eraseStyle.resolve().backColor;
+	if(copy()) {
+		fillRect(blankCol * charWidth, y, n * charWidth, charHeight, backColor);
+	} else {
+		// without the cell grid we don't know what to redraw, so just erase at the cursor
+		fillRect(col * charWidth, y, n * charWidth, charHeight, backColor);
 	}
 }
 
@@ -127,123 +620,350 @@ void Terminal::drawCursor()
 	//display.fillRect(x, y, t->char_width, t->char_height, t->front_color);
 }
 
-// sends the character to the display and updates cursor position
-void Terminal::putcInternal(uint8_t ch)
+// handle printable byte in ground state, decoding UTF-8 sequences
+void Terminal::print(uint8_t ch)
 {
-	if(ch < 0x20 || ch > 0x7e) {
-		putcInternal('0');
-		putcInternal('x');
-		putcInternal(hexchar((ch & 0xf0) >> 4));
-		putcInternal(hexchar(ch & 0x0f));
+	// ASCII bypasses the decoder
+	if(ch < 0x80 && !utf8.isPending()) {
+		putcInternal(ch);
 		return;
 	}
 
-	display.setFrontColor(frontColor);
-	display.setBackColor(backColor);
-	display.drawChar(cursorPos.col * charWidth, cursorPos.row * charHeight, ch);
+	auto codepoint = utf8.decode(ch);
+	if(codepoint == Utf8Decoder::interrupted) {
+		putCodepoint(Utf8Decoder::replacement);
+		codepoint = utf8.decode(ch);
+	}
+	if(codepoint != Utf8Decoder::pending) {
+		putCodepoint(codepoint);
+	}
+}
+
+void Terminal::putCodepoint(uint32_t codepoint)
+{
+	if(codepoint < 0x80) {
+		putcInternal(codepoint);
+		return;
+	}
+
+	// Cells have no room for combining marks, so they're dropped
+	auto width = getCodepointWidth(codepoint);
+	if(width == 0) {
+		return;
+	}
+
+	// The grid keeps the codepoint, so it can be sent on by getRepaint()
+	auto ch = gridEnabled ? getCharId(codepoint) : display.mapCodepoint(codepoint);
+	if(width == 1) {
+		putcInternal(ch);
+	} else {
+		putWide(ch);
+	}
+}
+
+// blank any double-width characters which are partly overwritten by cells [col, endCol) of a row
+void Terminal::splitWide(uint16_t row, uint16_t col, uint16_t endCol)
+{
+	if(row >= rowCount) {
+		return;
+	}
+	auto cells = grid.row(row);
+	if(col > 0 && col < colCount && cells[col].ch == Display::wideContinuation) {
+		grid.set(col - 1, row, {' ', cells[col - 1].attr});
+	}
+	if(endCol < colCount && cells[endCol].ch == Display::wideContinuation) {
+		grid.set(endCol, row, {' ', cells[endCol].attr});
+	}
+}
+
+// draws a double-width character, using two cells
+void Terminal::putWide(uint8_t ch)
+{
+	// wrap early rather than split the character
+	if(cursorPos.col + 2 > colCount) {
+		if(!flags.cursor_wrap || cursorPos.col >= colCount) {
+			return;
+		}
+		move(1, 0);
+	}
+
+	if(gridEnabled) {
+		splitWide(cursorPos.row, cursorPos.col, cursorPos.col + 2);
+		grid.set(cursorPos.col, cursorPos.row, {ch, attr});
+		grid.set(cursorPos.col + 1, cursorPos.row, {Display::wideContinuation, attr});
+	} else {
+		auto colors = style.resolve();
+		uint16_t x = cursorPos.col * charWidth;
+		uint16_t y = cursorPos.row * charHeight;
+		display.setFrontColor(colors.frontColor);
+		display.setBackColor(colors.backColor);
+		display.drawChar(x, y, ch);
+		display.drawChar(x + charWidth, y, ' ');
+		VT100_STATS(stats.displayCalls.setColor += 2);
+		VT100_STATS(stats.displayCalls.drawChar += 2);
+		if(style.flags & Style::underline) {
+			drawUnderline(cursorPos.col, cursorPos.row, 2, colors.frontColor);
+		}
+	}
+
+	move(2, 0);
+	drawCursor();
+}
+
+// sends the character to the display and updates cursor position
+void Terminal::putcInternal(uint8_t ch)
+{
+	if(gridEnabled) {
+		splitWide(cursorPos.row, cursorPos.col, cursorPos.col + 1);
+		grid.set(cursorPos.col, cursorPos.row, {ch, attr});
+	} else {
+		auto colors = style.resolve();
+		display.setFrontColor(colors.frontColor);
+		display.setBackColor(colors.backColor);
+		display.drawChar(cursorPos.col * charWidth, cursorPos.row * charHeight, ch);
+		VT100_STATS(stats.displayCalls.setColor += 2);
+		VT100_STATS(++stats.displayCalls.drawChar);
+		if(style.flags & Style::underline) {
+			drawUnderline(cursorPos.col, cursorPos.row, 1, colors.frontColor);
+		}
+	}
 
 	// move cursor right
 	move(1, 0);
 	drawCursor();
 }
 
-void Terminal::state_command_arg(uint8_t ev, uint16_t arg)
+// get length of printable text which fits on the current line
+unsigned Terminal::getTextRun(const char* str, const char* end) const
 {
-	if(ev != EV_CHAR) {
-		return;
+	if(cursorPos.col >= colCount) {
+		return 0;
 	}
+	auto limit = std::min(size_t(colCount - cursorPos.col), size_t(end - str));
+	return scanText(str, limit);
+}
 
-	if(isdigit(arg)) { // a digit argument
-		args.addDigit(arg);
-		return;
+// equivalent to calling putcInternal() for each character, but in one display call
+void Terminal::putRun(const char* str, unsigned length)
+{
+	if(gridEnabled) {
+		splitWide(cursorPos.row, cursorPos.col, cursorPos.col + length);
+		for(unsigned i = 0; i < length; ++i) {
+			grid.set(cursorPos.col + i, cursorPos.row, {uint8_t(str[i]), attr});
+		}
+	} else {
+		auto colors = style.resolve();
+		display.setFrontColor(colors.frontColor);
+		display.setBackColor(colors.backColor);
+		VT100_STATS(stats.displayCalls.setColor += 2);
+
+		// drawString() needs a NUL-terminated string
+		char buf[33];
+		uint16_t x = cursorPos.col * charWidth;
+		uint16_t y = cursorPos.row * charHeight;
+		for(unsigned i = 0; i < length;) {
+			unsigned n = std::min(length - i, unsigned(sizeof(buf) - 1));
+			memcpy(buf, &str[i], n);
+			buf[n] = '\0';
+			display.drawString(x, y, buf);
+			VT100_STATS(++stats.displayCalls.drawString);
+			x += n * charWidth;
+			i += n;
+		}
+		if(style.flags & Style::underline) {
+			drawUnderline(cursorPos.col, cursorPos.row, length, colors.frontColor);
+		}
 	}
 
-	if(arg == ';') { // separator
-		++args.count;
-		return;
+	move(length, 0);
+	drawCursor();
+}
+
+void Terminal::performAction(Action action, uint8_t ch)
+{
+	// controls and escape sequences interrupt incomplete characters
+	if(utf8.isPending() && action != Action::print && action != Action::none) {
+		utf8.reset();
+		putCodepoint(Utf8Decoder::replacement);
 	}
 
-	// no more arguments, go back to command state
-	++args.count;
-	state = ret_state;
-	ret_state = State::idle;
+	switch(action) {
+	case Action::print:
+		print(ch);
+		break;
 
-	// execute next state as well because we have already consumed a char!
-	callState(ev, arg);
+	case Action::execute:
+		execute(ch);
+		break;
+
+	case Action::clear:
+		args = {};
+		break;
+
+	case Action::collect:
+		args.collect(ch);
+		break;
+
+	case Action::param:
+		args.add(ch);
+		break;
+
+	case Action::esc_dispatch:
+		VT100_STATS(stats.countEsc(ch));
+		escDispatch(ch);
+		break;
+
+	case Action::csi_dispatch:
+		VT100_STATS(stats.countCsi(ch));
+		csiDispatch(ch);
+		break;
+
+	// Device control and operating system command strings are consumed but ignored
+	case Action::hook:
+	case Action::put:
+	case Action::unhook:
+	case Action::osc_start:
+	case Action::osc_put:
+	case Action::osc_end:
+	case Action::none:
+		break;
+	}
 }
 
-void Terminal::state_esc_sq_bracket(uint8_t ev, uint16_t arg)
+#if VT100_ENABLE_STATS
+// count sequences which get consumed without any effect
+void Terminal::countEntry(State newState)
 {
-	if(ev != EV_CHAR) {
-		// for all other events restore normal mode
-		state = State::idle;
-		return;
+	switch(newState) {
+	case State::csi_ignore:
+	case State::dcs_entry:
+	case State::osc_string:
+	case State::sos_pm_apc_string:
+		++stats.ignoredSequences;
+		break;
+	default:
+		break;
 	}
+}
+#endif
 
-	if(isdigit(arg)) {
-		// start of an argument
-		ret_state = State::esc_sq_bracket;
-		state_command_arg(ev, arg);
-		state = State::command_arg;
+void Terminal::csiDispatch(uint8_t ch)
+{
+	// '[?' DEC private mode commands
+	if(args.getIntermediate() == '?') {
+		switch(ch) {
+		// dec mode: OFF (arg[0] = function)
+		case 'l':
+		// dec mode: ON (arg[0] = function)
+		case 'h':
+			switch(args[0]) {
+			// cursor keys mode
+			case 1:
+				// h = esc 0 A for cursor up
+				// l = cursor keys send ansi commands
+				break;
+
+			// ansi / vt52
+			case 2:
+				// h = ansi mode
+				// l = vt52 mode
+				break;
+
+			case 3:
+				// h = 132 chars per line
+				// l = 80 chars per line
+				break;
+
+			case 4:
+				// h = smooth scroll
+				// l = jump scroll
+				break;
+
+			case 5:
+				// h = black on white bg
+				// l = white on black bg
+				break;
+
+			case 6:
+				// h = cursor relative to scroll region
+				// l = cursor independent of scroll region
+				flags.origin_mode = (ch == 'h') ? 1 : 0;
+				break;
+
+			case 7:
+				// h = new line after last column
+				// l = cursor stays at the end of line
+				flags.cursor_wrap = (ch == 'h') ? 1 : 0;
+				break;
+
+			case 8:
+				// h = keys will auto repeat
+				// l = keys do not auto repeat when held down
+				break;
+
+			case 9:
+				// h = display interlaced
+				// l = display not interlaced
+				break;
+
+				// 10-38 - all quite DEC-specific so omitted here
+			default:
+				VT100_STATS(++stats.unknownSequences);
+			}
+			break;
+
+		// Printing
+		case 'i':
+		// Request printer status
+		case 'n':
+		default:
+			VT100_STATS(++stats.unknownSequences);
+			break;
+		}
 		return;
 	}
 
-	if(arg == ';') {
-		// skip arg separator, and stay in the command state
+	// Other private or intermediate forms are not supported
+	if(args.intermediateCount != 0) {
+		VT100_STATS(++stats.unknownSequences);
 		return;
 	}
 
-	// otherwise we execute the command and go back to idle
-	switch(arg) {
+	switch(ch) {
 	// move cursor up (cursor stops at top margin)
 	case 'A': {
-		int n = (args.count > 0) ? args[0] : 1;
-		cursorPos.row -= n;
-		if(cursorPos.row < scrollStartRow) {
-			cursorPos.row = scrollStartRow;
-		}
-		state = State::idle;
+		int row = cursorPos.row - args.get(0, 1);
+		cursorPos.row = std::max(row, int(scrollStartRow));
 		break;
 	}
 
 	// cursor down (cursor stops at bottom margin)
 	case 'B': {
-		int n = (args.count > 0) ? args[0] : 1;
-		cursorPos.row += n;
-		if(cursorPos.row > scrollEndRow) {
-			cursorPos.row = scrollEndRow;
-		}
-		state = State::idle;
+		int row = cursorPos.row + args.get(0, 1);
+		cursorPos.row = std::min(row, int(scrollEndRow));
 		break;
 	}
 
 	// cursor right (cursor stops at right margin)
 	case 'C': {
-		int n = (args.count > 0) ? args[0] : 1;
-		cursorPos.col += n;
-		if(cursorPos.col > colCount)
-			cursorPos.col = colCount;
-		state = State::idle;
+		int col = cursorPos.col + args.get(0, 1);
+		cursorPos.col = std::min(col, int(colCount));
 		break;
 	}
 
 	// cursor left
 	case 'D': {
-		auto n = (args.count > 0) ? args[0] : 1;
-		cursorPos.col -= n;
-		if(cursorPos.col < 0) {
-			cursorPos.col = 0;
-		}
-		state = State::idle;
+		int col = cursorPos.col - args.get(0, 1);
+		cursorPos.col = std::max(col, 0);
 		break;
 	}
 
-	// move cursor to position (default 0;0)
+	// move cursor to position (default 1;1)
 	case 'f':
 	case 'H':
 		// cursor stops at respective margins
-		cursorPos.col = (args.count >= 1) ? (args[1] - 1) : 0;
-		cursorPos.row = (args.count == 2) ? (args[0] - 1) : 0;
+		cursorPos.row = args.get(0, 1) - 1;
+		cursorPos.col = args.get(1, 1) - 1;
 
 		if(flags.origin_mode) {
 			cursorPos.row += scrollStartRow;
@@ -258,410 +978,185 @@ void Terminal::state_esc_sq_bracket(uint8_t ev, uint16_t arg)
 		if(cursorPos.row >= rowCount) {
 			cursorPos.row = rowCount - 1;
 		}
-
-		state = State::idle;
 		break;
 
 	// clear screen from cursor up or down
 	case 'J':
-		if(args.count == 0 || (args.count == 1 && args[0] == 0)) {
+		if(args[0] == 0) {
 			// clear down to the bottom of screen (including cursor)
 			clearLines(cursorPos.row, rowCount);
-		} else if(args.count == 1 && args[0] == 1) {
+		} else if(args[0] == 1) {
 			// clear top of screen to current line (including cursor)
 			clearLines(0, cursorPos.row);
-		} else if(args.count == 1 && args[0] == 2) {
+		} else if(args[0] == 2) {
 			// clear whole screen
 			clearLines(0, rowCount);
 			// reset scroll value
 			resetScroll();
 		}
-		state = State::idle;
 		break;
 
 	// clear line from cursor right/left
 	case 'K': {
+		if(gridEnabled) {
+			Cell cell{' ', getStyleId(style.getEraseStyle())};
+			if(args[0] == 0) {
+				grid.fill(cursorPos.row, cursorPos.col, colCount, cell);
+			} else if(args[0] == 1) {
+				grid.fill(cursorPos.row, 0, cursorPos.col + 1, cell);
+			} else if(args[0] == 2) {
+				grid.fill(cursorPos.row, 0, colCount, cell);
+			}
+			break;
+		}
+
 		uint16_t x = cursorPos.col * charWidth;
 		uint16_t y = cursorPos.row * charHeight;
+		auto backColor = style.getEraseStyle().resolve().backColor;
 
-		if(args.count == 0 || (args.count == 1 && args[0] == 0)) {
+		if(args[0] == 0) {
 			// clear to end of line (to \n or to edge?), including cursor
-			display.fillRect(x, y, screenWidth - x, charHeight, backColor);
-		} else if(args.count == 1 && args[0] == 1) {
+			fillRect(x, y, screenWidth - x, charHeight, backColor);
+		} else if(args[0] == 1) {
 			// clear from left to current cursor position
-			display.fillRect(0, y, x + charWidth, charHeight, backColor);
-		} else if(args.count == 1 && args[0] == 2) {
+			fillRect(0, y, x + charWidth, charHeight, backColor);
+		} else if(args[0] == 2) {
 			// clear whole current line
-			display.fillRect(0, y, screenWidth, charHeight, backColor);
+			fillRect(0, y, screenWidth, charHeight, backColor);
 		}
-		state = State::idle;
 		break;
 	}
 
 	// insert lines (args[0] = number of lines)
 	case 'L':
 	// delete lines (args[0] = number of lines)
-	case 'M':
-		state = State::idle;
-		break;
-
-	// delete characters args[0] or 1 in front of cursor
-	case 'P': {
-		// TODO: this needs to correctly delete n chars
-		int n = ((args.count > 0) ? args[0] : 1);
-		move(-n, 0);
-		for(int c = 0; c < n; c++) {
-			putcInternal(' ');
+	case 'M': {
+		// only has an effect within the scroll region, moving the cursor to the start of the line
+		if(cursorPos.row < scrollStartRow || cursorPos.row > scrollEndRow) {
+			break;
 		}
-		state = State::idle;
+		int n = args.get(0, 1);
+		scrollRegion(cursorPos.row, scrollEndRow, (ch == 'L') ? -n : n);
+		cursorPos.col = 0;
 		break;
 	}
 
+	// delete characters args[0] or 1 at cursor, shifting the rest of the line left
+	case 'P':
+		shiftChars(-args.get(0, 1));
+		break;
+
+	// insert args[0] or 1 blank characters at cursor, shifting the rest of the line right
+	case '@':
+		shiftChars(args.get(0, 1));
+		break;
+
 	// query device code
 	case 'c':
 		callbacks.sendResponse("\e[?1;0c");
-		state = State::idle;
-		break;
-
-	case 'x':
-		state = State::idle;
 		break;
 
 	// save cursor pos
 	case 's':
 		savedCursorPos = cursorPos;
-		state = State::idle;
 		break;
 
 	// restore cursor pos
 	case 'u':
 		cursorPos = savedCursorPos;
-		// moveCursor(saved_cursor_x, saved_cursor_y);
-		state = State::idle;
 		break;
 
-	case 'h':
-	case 'l':
-		state = State::idle;
-		break;
-
-	case 'g':
-		state = State::idle;
-		break;
-
-	// sets colors. Accepts up to 3 args
-	case 'm':
-		// [m means reset the colors to default
-		if(args.count == 0) {
-			frontColor = 0xffff;
-			backColor = 0x0000;
-		}
-
-		while(args.count) {
-			args.count--;
-			int n = args[args.count];
-			static const uint16_t colors[] = {
-				0x0000, // black
-				0xf800, // red
-				0x0780, // green
-				0xfe00, // yellow
-				0x001f, // blue
-				0xf81f, // magenta
-				0x07ff, // cyan
-				0xffff  // white
-			};
-			if(n == 0) { // all attributes off
-				frontColor = 0xffff;
-				backColor = 0x0000;
-
-				display.setFrontColor(frontColor);
-				display.setBackColor(backColor);
-			}
-			if(n >= 30 && n < 38) { // fg colors
-				frontColor = colors[n - 30];
-				display.setFrontColor(frontColor);
-			} else if(n >= 40 && n < 48) {
-				backColor = colors[n - 40];
-				display.setBackColor(backColor);
-			}
-		}
-		state = State::idle;
-		break;
-
-	// Insert Characters
-	case '@':
-		state = State::idle;
+	// sets colors and attributes
+	case 'm': {
+		// applied to the display when characters are drawn
+		Style newStyle = style;
+		newStyle.applySgr(args.values, args.count);
+		setStyle(newStyle);
 		break;
+	}
 
 	// Set scroll region (top and bottom margins) e.g. [1;40r
-	case 'r':
+	case 'r': {
 		// the top value is first row of scroll region
 		// the bottom value is the first row of static region after scroll
-		if(args.count == 2 && args[0] < args[1]) {
-			scrollStartRow = args[0] - 1;
-			scrollEndRow = args[1] - 1;
+		uint16_t top = std::min(args.get(0, 1), rowCount);
+		uint16_t bottom = std::min(args.get(1, rowCount), rowCount);
+		if(top < bottom) {
+			scrollStartRow = top - 1;
+			scrollEndRow = bottom - 1;
 		} else {
 			resetScroll();
 		}
-		state = State::idle;
 		break;
+	}
 
 	// Printing
 	case 'i':
 	// self test modes..
 	case 'y':
-
-	// argument follows...
-	case '=': {
-		//state = State::screen_mode;
-		state = State::idle;
-		break;
-	}
-
-	// '[?' escape mode
-	case '?':
-		state = State::esc_question;
-		break;
-
-		// unknown sequence
-	default:
-		state = State::idle;
-	}
-}
-
-void Terminal::state_esc_question(uint8_t ev, uint16_t arg)
-{
-	// DEC mode commands
-	if(ev != EV_CHAR) {
-		return;
-	}
-
-	if(isdigit(arg)) { // start of an argument
-		ret_state = State::esc_question;
-		state_command_arg(ev, arg);
-		state = State::command_arg;
-		return;
-	}
-
-	// arg separator
-	if(arg == ';') {
-		// skip. And also stay in the command state
-		return;
-	}
-
-	switch(arg) {
-	// dec mode: OFF (arg[0] = function)
+	case 'x':
+	case 'h':
 	case 'l':
-	// dec mode: ON (arg[0] = function)
-	case 'h': {
-		switch(args[0]) {
-		// cursor keys mode
-		case 1:
-			// h = esc 0 A for cursor up
-			// l = cursor keys send ansi commands
-			break;
-
-		// ansi / vt52
-		case 2:
-			// h = ansi mode
-			// l = vt52 mode
-			break;
-
-		case 3:
-			// h = 132 chars per line
-			// l = 80 chars per line
-			break;
-
-		case 4:
-			// h = smooth scroll
-			// l = jump scroll
-			break;
-
-		case 5:
-			// h = black on white bg
-			// l = white on black bg
-			break;
-
-		case 6:
-			// h = cursor relative to scroll region
-			// l = cursor independent of scroll region
-			flags.origin_mode = (arg == 'h') ? 1 : 0;
-			break;
-
-		case 7:
-			// h = new line after last column
-			// l = cursor stays at the end of line
-			flags.cursor_wrap = (arg == 'h') ? 1 : 0;
-			break;
-
-		case 8:
-			// h = keys will auto repeat
-			// l = keys do not auto repeat when held down
-			break;
-
-		case 9:
-			// h = display interlaced
-			// l = display not interlaced
-			break;
-
-			// 10-38 - all quite DEC-specific so omitted here
-		}
-		state = State::idle;
-		break;
-	}
-
-	// Printing
-	case 'i':
-	// Request printer status
-	case 'n':
+	case 'g':
+	// unknown sequence
 	default:
+		VT100_STATS(++stats.unknownSequences);
 		break;
 	}
-
-	state = State::idle;
 }
 
-void Terminal::state_esc_left_br(uint8_t ev, uint16_t arg)
+void Terminal::escDispatch(uint8_t ch)
 {
-	if(ev != EV_CHAR) {
-		return;
-	}
-
-	switch(arg) {
-	case 'A':
-	case 'B':
-		// translation map command?
-	case '0':
-	case 'O':
-		// another translation map command?
-		state = State::idle;
+	switch(args.getIntermediate()) {
+	case '\0':
 		break;
-	default:
-		state = State::idle;
-	}
-	//state = State::idle;
-}
 
-void Terminal::state_esc_right_br(uint8_t ev, uint16_t arg)
-{
-	if(ev != EV_CHAR) {
+	// ESC ( and ESC ) select character sets: translation maps not supported
+	case '(':
+	case ')':
+		VT100_STATS(++stats.unknownSequences);
 		return;
-	}
-
-	switch(arg) {
-	case 'A':
-	case 'B':
-		// translation map command?
-	case '0':
-	case 'O':
-		// another translation map command?
-		state = State::idle;
-		break;
-	default:
-		state = State::idle;
-	}
-	//state = State::idle;
-}
 
-void Terminal::state_esc_hash(uint8_t ev, uint16_t arg)
-{
-	if(ev != EV_CHAR) {
+	// ESC #
+	case '#':
+		if(ch == '8') {
+			// self test: fill the screen with 'E'
+		}
+		VT100_STATS(++stats.unknownSequences);
 		return;
-	}
-
-	switch(arg) {
-	case '8': {
-		// self test: fill the screen with 'E'
 
-		state = State::idle;
-		break;
-	}
 	default:
-		state = State::idle;
-	}
-}
-
-void Terminal::state_escape(uint8_t ev, uint16_t arg)
-{
-	if(ev != EV_CHAR) {
-		// for all other events restore normal mode
-		state = State::idle;
+		VT100_STATS(++stats.unknownSequences);
 		return;
 	}
 
-	switch(arg) {
-	// command
-	case '[': {
-		// prepare command state and switch to it
-		args = {};
-		state = State::esc_sq_bracket;
-		break;
-	}
-
-	/* ESC ( */
-	case '(':
-		args = {};
-		state = State::esc_left_br;
-		break;
-
-	/* ESC ) */
-	case ')':
-		args = {};
-		state = State::esc_right_br;
-		break;
-
-	// ESC #
-	case '#':
-		args = {};
-		state = State::esc_hash;
-		break;
-
-	// ESC P (DCS, Device Control String)
-	case 'P':
-		state = State::idle;
-		break;
-
+	switch(ch) {
 	// move cursor down one line and scroll window if at bottom line
 	case 'D':
 		move(0, 1);
-		state = State::idle;
 		break;
 
 	// move cursor up one line and scroll window if at top line
 	case 'M':
 		move(0, -1);
-		state = State::idle;
 		break;
 
 	// next line (same as '\r\n')
 	case 'E':
 		move(0, 1);
 		cursorPos.col = 0;
-		state = State::idle;
 		break;
 
 	// Save attributes and cursor position
 	case '7':
 	case 's':
 		savedCursorPos = cursorPos;
-		state = State::idle;
 		break;
 
 	// Restore attributes and cursor position
 	case '8':
 	case 'u':
 		cursorPos = savedCursorPos;
-		state = State::idle;
-		break;
-
-	// Keypad into applications mode
-	case '=':
-		state = State::idle;
-		break;
-
-	// Keypad into numeric mode
-	case '>':
-		state = State::idle;
 		break;
 
 	// Report terminal type
@@ -670,15 +1165,17 @@ void Terminal::state_escape(uint8_t ev, uint16_t arg)
 		callbacks.sendResponse("\033[?1;0c");
 		// unknown terminal
 		//out("\033[?c");
-		state = State::idle;
 		break;
 
 	// Reset terminal to initial state
 	case 'c':
 		reset();
-		state = State::idle;
 		break;
 
+	// Keypad into applications mode
+	case '=':
+	// Keypad into numeric mode
+	case '>':
 	// Set tab in current position
 	case 'H':
 	// G2 character set for next character only
@@ -687,28 +1184,18 @@ void Terminal::state_escape(uint8_t ev, uint16_t arg)
 	case 'O':
 	// Exit vt52 mode
 	case '<':
-		// ignore
-		state = State::idle;
-		break;
-
-	// marks start of next escape sequence
-	case KEY_ESC:
-		// stay in escape state
-		break;
-
-	// unknown sequence - return to normal mode
+	// String terminator
+	case '\\':
+	// unknown sequence
 	default:
-		state = State::idle;
+		VT100_STATS(++stats.unknownSequences);
+		break;
 	}
 }
 
-void Terminal::state_idle(uint8_t ev, uint16_t arg)
+void Terminal::execute(uint8_t ch)
 {
-	if(ev != EV_CHAR) {
-		return;
-	}
-
-	switch(arg) {
+	switch(ch) {
 	// AnswerBack for vt100's
 	case 5:
 		// should send SCCS_ID?
@@ -719,23 +1206,17 @@ void Terminal::state_idle(uint8_t ev, uint16_t arg)
 	case '\n':
 		move(0, 1);
 		cursorPos.col = 0;
-		// moveCursor(0, cursorPos.row + 1);
-		// do scrolling here!
 		break;
 
 	// carrage return (0x0d)
 	case '\r':
 		cursorPos.col = 0;
-		// move(0, 1);
-		// moveCursor(0, cursorPos.row);
 		break;
 
 	// backspace 0x08
 	case '\b':
 		move(-1, 0);
 		// backspace does not delete the character! Only moves cursor!
-		//display.drawChar(cursorPos.col * char_width,
-		//	cursorPos.row * char_height, ' ');
 		break;
 
 	// del - delete character under cursor
@@ -745,7 +1226,6 @@ void Terminal::state_idle(uint8_t ev, uint16_t arg)
 		// fill the current position with background color
 		putcInternal(' ');
 		move(-1, 0);
-		// clearChar(cursorPos.col, cursorPos.row);
 		break;
 
 	// tab
@@ -765,50 +1245,121 @@ void Terminal::state_idle(uint8_t ev, uint16_t arg)
 		// skip
 		break;
 
-	// escape
-	case KEY_ESC:
-		state = State::escape;
-		break;
-
+	// other control characters are ignored
 	default:
-		putcInternal(arg);
+		break;
 	}
 }
 
 void Terminal::putc(uint8_t c, unsigned count)
 {
 	while(count--) {
-		callState(EV_CHAR, 0x0000 | c);
+		parse(c);
+	}
+	if(!isFramePaced()) {
+		flush();
 	}
 }
 
 void Terminal::puts(const char* str)
 {
-	while(*str) {
-		putc(*str++);
-	}
+	nputs(str, strlen(str));
 }
 
 size_t Terminal::nputs(const char* str, size_t length)
 {
-	unsigned n = length;
-	while(n--) {
-		putc(*str++);
+	parseText(str, length);
+	if(!isFramePaced()) {
+		flush();
 	}
 	return length;
 }
 
+size_t Terminal::nputs(const InputSpan* spans, size_t count)
+{
+	size_t total = 0;
+	for(size_t i = 0; i < count; ++i) {
+		parseText(spans[i].data, spans[i].length);
+		total += spans[i].length;
+	}
+	if(!isFramePaced()) {
+		flush();
+	}
+	return total;
+}
+
+void Terminal::parseText(const char* str, size_t length)
+{
+	auto end = str + length;
+	while(str < end) {
+		// plain text goes straight to the display, bypassing the state machine
+		if(state == State::ground && !utf8.isPending()) {
+			auto n = getTextRun(str, end);
+			if(n != 0) {
+				VT100_STATS(stats.stateBytes[unsigned(State::ground)] += n);
+				putRun(str, n);
+				str += n;
+				continue;
+			}
+		}
+		parse(*str++);
+	}
+}
+
+bool Terminal::enableInputRing(size_t capacity)
+{
+	if(capacity == 0) {
+		input.end();
+		return true;
+	}
+	return input.begin(capacity);
+}
+
+size_t Terminal::pump(size_t maxBytes, uint32_t (*clock)(), uint32_t deadline)
+{
+	size_t total = 0;
+	while(total < maxBytes) {
+		const uint8_t* data;
+		size_t n = std::min(input.peek(data), maxBytes - total);
+		if(n == 0) {
+			break;
+		}
+		if(clock != nullptr && n > pumpBlockSize) {
+			n = pumpBlockSize;
+		}
+		parseText(reinterpret_cast<const char*>(data), n);
+		input.consume(n);
+		total += n;
+		if(clock != nullptr && int32_t(clock() - deadline) >= 0) {
+			break;
+		}
+	}
+	if(total != 0 && !isFramePaced()) {
+		flush();
+	}
+	return total;
+}
+
 size_t Terminal::printf(const char* fmt, ...)
 {
 	va_list args;
 
 	va_start(args, fmt);
-	char buf[256];
-	size_t n = m_vsnprintf(buf, sizeof(buf), fmt, args);
+	size_t n = vprintf(fmt, args);
 	va_end(args);
 
-	nputs(buf, n);
+	return n;
+}
 
+size_t Terminal::vprintf(const char* fmt, va_list args)
+{
+	auto writer = [](void* param, const char* data, size_t length) {
+		static_cast<Terminal*>(param)->parseText(data, length);
+	};
+	size_t n = formatStream(writer, this, fmt, args);
+	if(!isFramePaced()) {
+		flush();
+	}
 	return n;
 }
 
@@ -0,0 +1,1341 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+#include "include/VT100/Terminal.h"
+
+/*
+ * Snapshot format, all values little-endian:
+ *
+ * 	header:  magic (2) | version (1) | type (1) | cols (2) | rows (2) | [base checksum (4), delta only]
+ * 	state:   flags (1) | cursor col, row (4) | saved col, row (4) | scroll top, bottom (4) | style (5)
+ * 	         | parser state (1) | arg count (1) | args (2 each) | intermediate count (1) | intermediates
+ * 	         | args overflow (1) | UTF-8 codepoint (4) | UTF-8 remaining (1) | UTF-8 length (1)
+ * 	styles:  count (1) | { id (1) | style (5) }...
+ * 	chars:   count (1) | { id (1) | codepoint (4) }...
+ * 	cells:   runs covering the screen, row by row
+ * 	checksum (4), FNV-1a of everything before it
+ *
+ * Each run starts with a header byte:
+ *
+ * 	0x00-0x7f: 1-128 cells follow, each as character or character ID (1) and style ID (1)
+ * 	0x80-0xbf: 1-64 cells are the same as in the base snapshot (delta only)
+ * 	0xc0-0xff: 1-64 copies of the one cell which follows
+ */
+
+namespace VT100
+{
+namespace
+{
+const uint16_t magic = 0x5456; // "VT"
+const uint8_t version = 2;
+const uint8_t typeFull = 0;
+const uint8_t typeDelta = 1;
+const unsigned maxLiteralRun = 128;
+const unsigned maxRepeatRun = 64;
+const uint8_t skipRun = 0x80;
+const uint8_t repeatRun = 0xc0;
+// Shortest run of identical cells worth storing as a repeat
+const unsigned minRepeatRun = 3;
+const size_t checksumSize = 4;
+
+uint32_t fnv1a(const uint8_t* data, size_t length)
+{
+	uint32_t hash = 2166136261U;
+	for(size_t i = 0; i < length; ++i) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+	return hash;
+}
+
+// Writes as much as fits, while counting everything
+class Writer
+{
+public:
+	Writer(uint8_t* buffer, size_t size) : buffer(buffer), size(buffer ? size : 0)
+	{
+	}
+
+	void u8(uint8_t value)
+	{
+		if(pos < size) {
+			buffer[pos] = value;
+		}
+		++pos;
+	}
+
+	void u16(uint16_t value)
+	{
+		u8(value);
+		u8(value >> 8);
+	}
+
+	void u32(uint32_t value)
+	{
+		u16(value);
+		u16(value >> 16);
+	}
+
+	void style(const Style& style)
+	{
+		u16(style.fore);
+		u16(style.back);
+		u8(style.flags);
+	}
+
+	void cell(const Cell& cell)
+	{
+		u8(cell.ch);
+		u8(cell.attr);
+	}
+
+	void text(const char* str, size_t length)
+	{
+		for(size_t i = 0; i < length; ++i) {
+			u8(str[i]);
+		}
+	}
+
+	void patch(size_t offset, uint8_t value)
+	{
+		if(offset < size) {
+			buffer[offset] = value;
+		}
+	}
+
+	void checksum()
+	{
+		u32((pos <= size) ? fnv1a(buffer, pos) : 0);
+	}
+
+	size_t pos{0};
+
+private:
+	uint8_t* buffer;
+	size_t size;
+};
+
+// Reads until the data runs out, then returns zeroes and flags an error
+class Reader
+{
+public:
+	Reader(const uint8_t* data, size_t size) : data(data), size(size)
+	{
+	}
+
+	uint8_t u8()
+	{
+		if(pos >= size) {
+			error = true;
+			return 0;
+		}
+		return data[pos++];
+	}
+
+	uint16_t u16()
+	{
+		uint16_t value = u8();
+		return value | (u8() << 8);
+	}
+
+	uint32_t u32()
+	{
+		uint32_t value = u16();
+		return value | (uint32_t(u16()) << 16);
+	}
+
+	Style style()
+	{
+		Style style;
+		style.fore = u16();
+		style.back = u16();
+		style.flags = u8();
+		return style;
+	}
+
+	Cell cell()
+	{
+		Cell cell;
+		cell.ch = u8();
+		cell.attr = u8();
+		return cell;
+	}
+
+	size_t pos{0};
+	bool error{false};
+
+private:
+	const uint8_t* data;
+	size_t size;
+};
+
+struct Header {
+	uint8_t type;
+	uint16_t cols;
+	uint16_t rows;
+	uint32_t baseChecksum;
+};
+
+uint32_t getChecksum(const uint8_t* data, size_t size)
+{
+	Reader reader(data + size - checksumSize, checksumSize);
+	return reader.u32();
+}
+
+// Check integrity and read the header
+bool readHeader(Reader& reader, const uint8_t* data, size_t size, Header& header)
+{
+	if(data == nullptr || size < 8 + checksumSize || fnv1a(data, size - checksumSize) != getChecksum(data, size)) {
+		return false;
+	}
+	if(reader.u16() != magic || reader.u8() != version) {
+		return false;
+	}
+	header.type = reader.u8();
+	header.cols = reader.u16();
+	header.rows = reader.u16();
+	if(header.type == typeDelta) {
+		header.baseChecksum = reader.u32();
+	} else if(header.type != typeFull) {
+		return false;
+	}
+	return !reader.error;
+}
+
+// The parts of the terminal state which affect what's on screen
+struct ScreenState {
+	uint8_t flags;
+	uint16_t cursorCol;
+	uint16_t cursorRow;
+	uint16_t savedCol;
+	uint16_t savedRow;
+	uint16_t scrollStart;
+	uint16_t scrollEnd;
+	Style style;
+};
+
+// Read the screen state and skip the rest, leaving the reader at the style table
+ScreenState readScreenState(Reader& reader)
+{
+	ScreenState state;
+	state.flags = reader.u8();
+	state.cursorCol = reader.u16();
+	state.cursorRow = reader.u16();
+	state.savedCol = reader.u16();
+	state.savedRow = reader.u16();
+	state.scrollStart = reader.u16();
+	state.scrollEnd = reader.u16();
+	state.style = reader.style();
+	// Parser state and args
+	reader.pos += 1;
+	unsigned argCount = reader.u8();
+	reader.pos += argCount * 2;
+	unsigned intermediateCount = reader.u8();
+	// Intermediates, args overflow flag and UTF-8 decoder
+	reader.pos += intermediateCount + 1 + 6;
+	return state;
+}
+
+// Style of each ID used in a snapshot
+class SnapshotStyles
+{
+public:
+	SnapshotStyles()
+	{
+		styles[0] = defaultStyle;
+	}
+
+	bool read(Reader& reader)
+	{
+		unsigned count = reader.u8();
+		for(unsigned i = 0; i < count; ++i) {
+			uint8_t id = reader.u8();
+			auto style = reader.style();
+			if(id >= StyleTable::maxStyles) {
+				return false;
+			}
+			styles[id] = style;
+		}
+		return !reader.error;
+	}
+
+	const Style& operator[](uint8_t id) const
+	{
+		return styles[(id < StyleTable::maxStyles) ? id : 0];
+	}
+
+private:
+	Style styles[StyleTable::maxStyles]{};
+};
+
+// Codepoint of each character ID used in a snapshot
+class SnapshotChars
+{
+public:
+	SnapshotChars()
+	{
+		for(auto& codepoint : codepoints) {
+			codepoint = Utf8Decoder::replacement;
+		}
+	}
+
+	bool read(Reader& reader)
+	{
+		unsigned count = reader.u8();
+		for(unsigned i = 0; i < count; ++i) {
+			uint8_t id = reader.u8();
+			uint32_t codepoint = reader.u32();
+			if(!CharTable::isId(id) || codepoint < 0x80 || codepoint > 0x10ffff) {
+				return false;
+			}
+			codepoints[id - CharTable::firstId] = codepoint;
+		}
+		return !reader.error;
+	}
+
+	// Codepoint for the content of a cell
+	uint32_t operator[](uint8_t ch) const
+	{
+		if(ch < CharTable::firstId) {
+			return ch;
+		}
+		if(!CharTable::isId(ch)) {
+			return Utf8Decoder::replacement;
+		}
+		return codepoints[ch - CharTable::firstId];
+	}
+
+private:
+	uint32_t codepoints[CharTable::maxChars];
+};
+
+// Walks through the cell runs of a snapshot one cell at a time
+class RunReader
+{
+public:
+	RunReader(Reader& reader) : reader(reader)
+	{
+	}
+
+	/**
+	 * @brief Get the next cell
+	 * @retval bool false if the cell is unchanged from the base
+	 */
+	bool next(Cell& cell)
+	{
+		if(remaining == 0) {
+			kind = reader.u8();
+			if(kind < skipRun) {
+				remaining = kind + 1;
+				kind = 0;
+			} else {
+				remaining = (kind & 0x3f) + 1;
+				kind &= repeatRun;
+				if(kind == repeatRun) {
+					repeatCell = reader.cell();
+				}
+			}
+		}
+		--remaining;
+		if(kind == 0) {
+			cell = reader.cell();
+			return true;
+		}
+		cell = repeatCell;
+		return kind == repeatRun;
+	}
+
+private:
+	Reader& reader;
+	Cell repeatCell{};
+	unsigned remaining{0};
+	uint8_t kind{0};
+};
+
+// Encodes cells, choosing the run types
+class RunWriter
+{
+public:
+	RunWriter(Writer& writer) : writer(writer)
+	{
+	}
+
+	~RunWriter()
+	{
+		endRepeat();
+		endSkip();
+		endLiteral();
+	}
+
+	void put(const Cell& cell)
+	{
+		endSkip();
+		if(repeatCount != 0 && cell == repeatCell && repeatCount < maxRepeatRun) {
+			++repeatCount;
+			return;
+		}
+		endRepeat();
+		repeatCell = cell;
+		repeatCount = 1;
+	}
+
+	// Cell is unchanged from the base
+	void skip()
+	{
+		endRepeat();
+		endLiteral();
+		if(++skipCount == maxRepeatRun) {
+			endSkip();
+		}
+	}
+
+private:
+	void literal(const Cell& cell)
+	{
+		if(literalCount == 0) {
+			literalPos = writer.pos;
+			writer.u8(0);
+		}
+		writer.cell(cell);
+		if(++literalCount == maxLiteralRun) {
+			endLiteral();
+		}
+	}
+
+	void endLiteral()
+	{
+		if(literalCount != 0) {
+			writer.patch(literalPos, literalCount - 1);
+			literalCount = 0;
+		}
+	}
+
+	void endRepeat()
+	{
+		if(repeatCount >= minRepeatRun) {
+			endLiteral();
+			writer.u8(repeatRun | (repeatCount - 1));
+			writer.cell(repeatCell);
+		} else {
+			for(unsigned i = 0; i < repeatCount; ++i) {
+				literal(repeatCell);
+			}
+		}
+		repeatCount = 0;
+	}
+
+	void endSkip()
+	{
+		if(skipCount != 0) {
+			writer.u8(skipRun | (skipCount - 1));
+			skipCount = 0;
+		}
+	}
+
+	Writer& writer;
+	Cell repeatCell{};
+	size_t literalPos{0};
+	unsigned literalCount{0};
+	unsigned repeatCount{0};
+	unsigned skipCount{0};
+};
+
+// Short escape sequences are built in one of these, so alternatives can be compared
+class Sequence
+{
+public:
+	void add(char c)
+	{
+		if(length < sizeof(text)) {
+			text[length++] = c;
+		}
+	}
+
+	void add(const char* str)
+	{
+		while(*str != '\0') {
+			add(*str++);
+		}
+	}
+
+	void add(const Sequence& other)
+	{
+		for(unsigned i = 0; i < other.length; ++i) {
+			add(other.text[i]);
+		}
+	}
+
+	void number(unsigned value)
+	{
+		char digits[5];
+		unsigned n = 0;
+		do {
+			digits[n++] = '0' + (value % 10);
+			value /= 10;
+		} while(value != 0 && n < sizeof(digits));
+		while(n != 0) {
+			add(digits[--n]);
+		}
+	}
+
+	// CSI with one optional parameter, which is omitted when it's the default of 1
+	void csi(unsigned param, char final)
+	{
+		add("\x1b[");
+		if(param != 1) {
+			number(param);
+		}
+		add(final);
+	}
+
+	char text[128];
+	unsigned length{0};
+};
+
+// Builds SGR sequences, splitting them so no more than Args::maxCount parameters are sent at once
+class SgrSequence : public Sequence
+{
+public:
+	// Parameters which must stay in the same sequence, e.g. 38;2;r;g;b
+	void group(const uint16_t* params, unsigned count)
+	{
+		if(paramCount + count > maxParams) {
+			add('m');
+			paramCount = 0;
+		}
+		for(unsigned i = 0; i < count; ++i) {
+			add((paramCount == 0) ? "\x1b[" : ";");
+			number(params[i]);
+			++paramCount;
+		}
+	}
+
+	void param(uint16_t value)
+	{
+		group(&value, 1);
+	}
+
+	void color(uint16_t color, bool rgb, unsigned base)
+	{
+		if(rgb) {
+			uint8_t r = color >> 11;
+			uint8_t g = (color >> 5) & 0x3f;
+			uint8_t b = color & 0x1f;
+			uint16_t params[] = {uint16_t(base + 8), 2, uint16_t((r << 3) | (r >> 2)), uint16_t((g << 2) | (g >> 4)),
+								 uint16_t((b << 3) | (b >> 2))};
+			group(params, 5);
+		} else if(color < 8) {
+			param(base + color);
+		} else if(color < 16) {
+			param(base + 60 + color - 8);
+		} else {
+			uint16_t params[] = {uint16_t(base + 8), 5, color};
+			group(params, 3);
+		}
+	}
+
+	void end()
+	{
+		if(paramCount != 0) {
+			add('m');
+			paramCount = 0;
+		}
+	}
+
+private:
+	static constexpr unsigned maxParams = 16;
+	unsigned paramCount{0};
+};
+
+// A cell with its character and style resolved, so cells from different snapshots can be compared
+struct RepaintCell {
+	uint32_t ch;
+	Style style;
+
+	bool operator!=(const RepaintCell& other) const
+	{
+		return ch != other.ch || style != other.style;
+	}
+};
+
+/*
+ * Tracks what the other terminal is known to have, so as to send the least to change it.
+ * Drawing is done with autowrap off and without a scroll region or origin mode.
+ */
+class Repainter
+{
+public:
+	Repainter(Writer& writer, uint16_t cols, uint16_t rows) : writer(writer), cols(cols), rows(rows)
+	{
+	}
+
+	void send(const Sequence& seq)
+	{
+		writer.text(seq.text, seq.length);
+	}
+
+	void send(const char* str)
+	{
+		writer.text(str, strlen(str));
+	}
+
+	/**
+	 * @brief Move the cursor
+	 * @param row
+	 * @param col
+	 * @param cells Contents of the row, which may be rewritten to move right if that's shorter
+	 */
+	void moveTo(uint16_t row, uint16_t col, const RepaintCell* cells = nullptr)
+	{
+		if(cursorKnown && row == cursorRow && col == cursorCol) {
+			return;
+		}
+
+		Sequence best;
+		if(row == 0 && col == 0) {
+			best.add("\x1b[H");
+		} else {
+			best.add("\x1b[");
+			best.number(row + 1);
+			if(col != 0) {
+				best.add(';');
+				best.number(col + 1);
+			}
+			best.add('H');
+		}
+
+		if(cursorKnown) {
+			auto consider = [&](const Sequence& seq) {
+				if(seq.length < best.length) {
+					best = seq;
+				}
+			};
+
+			// Vertical move, then horizontal
+			Sequence vertical;
+			uint16_t fromCol = cursorCol;
+			if(row == cursorRow + 1) {
+				vertical.add("\r\n");
+				fromCol = 0;
+			} else if(row > cursorRow) {
+				vertical.csi(row - cursorRow, 'B');
+			} else if(row < cursorRow) {
+				vertical.csi(cursorRow - row, 'A');
+			}
+
+			Sequence seq;
+			seq.add(vertical);
+			if(col > fromCol) {
+				seq.csi(col - fromCol, 'C');
+				consider(seq);
+				// Writing the characters in between is cheaper for short gaps
+				if(row == cursorRow && cells != nullptr && sgrKnown && unsigned(col - fromCol) < best.length) {
+					Sequence gap;
+					unsigned c = fromCol;
+					while(c < col && isPrintable(cells[c].ch) && cells[c].style == sgr) {
+						gap.add(cells[c++].ch);
+					}
+					if(c == col) {
+						consider(gap);
+					}
+				}
+			} else if(col < fromCol) {
+				if(col + 1 == fromCol) {
+					seq.add('\b');
+				} else {
+					seq.csi(fromCol - col, 'D');
+				}
+				consider(seq);
+				Sequence cr;
+				cr.add(vertical);
+				cr.add('\r');
+				if(col != 0) {
+					cr.csi(col, 'C');
+				}
+				consider(cr);
+			} else {
+				consider(seq);
+			}
+		}
+
+		send(best);
+		cursorRow = row;
+		cursorCol = col;
+		cursorKnown = true;
+	}
+
+	void setStyle(const Style& style)
+	{
+		if(sgrKnown && style == sgr) {
+			return;
+		}
+
+		// Either reset and set everything, or change only what differs
+		SgrSequence full;
+		full.param(0);
+		addAttributes(full, defaultStyle, style);
+		full.end();
+		// A leading 0 may be left out, as in `CSI m` or `CSI ;1m`
+		memmove(&full.text[2], &full.text[3], --full.length - 2);
+
+		if(sgrKnown) {
+			SgrSequence changes;
+			addAttributes(changes, sgr, style);
+			changes.end();
+			if(changes.length < full.length) {
+				full = changes;
+			}
+		}
+
+		send(full);
+		sgr = style;
+		sgrKnown = true;
+	}
+
+	/**
+	 * @brief Write a character
+	 * @param ch Codepoint
+	 * @param width Number of cells it covers
+	 */
+	void put(uint32_t ch, unsigned width = 1)
+	{
+		if(ch >= 0x80) {
+			char utf8[4];
+			writer.text(utf8, encodeUtf8(ch, utf8));
+		} else {
+			writer.u8(isPrintable(ch) ? ch : (ch == Display::wideContinuation) ? ' ' : '?');
+		}
+		// Terminals differ in where the cursor ends up after the last column
+		cursorCol += width;
+		if(cursorCol >= cols) {
+			cursorKnown = false;
+		}
+	}
+
+	static bool isPrintable(uint32_t ch)
+	{
+		return ch >= 0x20 && ch < 0x7f;
+	}
+
+	const Style& getStyle() const
+	{
+		return sgr;
+	}
+
+	// The other terminal moves the cursor home for some mode changes
+	void cursorMoved()
+	{
+		cursorKnown = false;
+	}
+
+	// What the other terminal has at the start
+	void setKnown(uint16_t row, uint16_t col, const Style& style)
+	{
+		cursorRow = row;
+		cursorCol = col;
+		cursorKnown = (col < cols && row < rows);
+		sgr = style;
+		sgrKnown = true;
+	}
+
+private:
+	static void addAttributes(SgrSequence& seq, const Style& from, const Style& to)
+	{
+		static const struct {
+			uint8_t flag;
+			uint8_t on;
+			uint8_t off;
+		} attributes[] = {
+			{Style::bold, 1, 22},	{Style::dim, 2, 22},	 {Style::underline, 4, 24},
+			{Style::blink, 5, 25},	{Style::reverse, 7, 27}, {Style::conceal, 8, 28},
+		};
+
+		// 22 turns off both bold and dim
+		uint8_t removed = from.flags & ~to.flags;
+		uint8_t flags = from.flags;
+		for(auto& attr : attributes) {
+			if((removed & attr.flag) && (flags & attr.flag)) {
+				seq.param(attr.off);
+				flags &= (attr.off == 22) ? ~(Style::bold | Style::dim) : ~attr.flag;
+			}
+		}
+		for(auto& attr : attributes) {
+			if((to.flags & attr.flag) && !(flags & attr.flag)) {
+				seq.param(attr.on);
+			}
+		}
+
+		if(to.fore != from.fore || ((to.flags ^ from.flags) & Style::foreRgb)) {
+			bool rgb = to.flags & Style::foreRgb;
+			if(!rgb && to.fore == Style::white) {
+				seq.param(39);
+			} else {
+				seq.color(to.fore, rgb, 30);
+			}
+		}
+		if(to.back != from.back || ((to.flags ^ from.flags) & Style::backRgb)) {
+			bool rgb = to.flags & Style::backRgb;
+			if(!rgb && to.back == Style::black) {
+				seq.param(49);
+			} else {
+				seq.color(to.back, rgb, 40);
+			}
+		}
+	}
+
+	Writer& writer;
+	uint16_t cols;
+	uint16_t rows;
+	uint16_t cursorRow{0};
+	uint16_t cursorCol{0};
+	Style sgr{defaultStyle};
+	bool cursorKnown{false};
+	bool sgrKnown{false};
+};
+
+/*
+ * Find how many lines the screen has scrolled up (> 0) or down (< 0) since the base,
+ * by matching row hashes. 0 if scrolling wouldn't make more rows the same.
+ */
+template <typename GetCell, typename GetClientCell>
+int findScroll(uint16_t cols, uint16_t rows, GetCell getCell, GetClientCell getClientCell)
+{
+	auto hashes = new(std::nothrow) uint32_t[rows * 2];
+	if(hashes == nullptr) {
+		return 0;
+	}
+	auto target = hashes;
+	auto client = &hashes[rows];
+
+	auto hashCell = [](uint32_t hash, const RepaintCell& cell) {
+		const uint8_t bytes[] = {uint8_t(cell.ch),
+								 uint8_t(cell.ch >> 8),
+								 uint8_t(cell.ch >> 16),
+								 uint8_t(cell.style.fore),
+								 uint8_t(cell.style.fore >> 8),
+								 uint8_t(cell.style.back),
+								 uint8_t(cell.style.back >> 8),
+								 cell.style.flags};
+		for(auto b : bytes) {
+			hash = (hash ^ b) * 16777619U;
+		}
+		return hash;
+	};
+	uint32_t blank = 2166136261U;
+	for(unsigned c = 0; c < cols; ++c) {
+		blank = hashCell(blank, RepaintCell{' ', defaultStyle});
+	}
+	unsigned unchanged = 0;
+	for(unsigned r = 0; r < rows; ++r) {
+		target[r] = client[r] = 2166136261U;
+		for(unsigned c = 0; c < cols; ++c) {
+			target[r] = hashCell(target[r], getCell(r, c));
+			client[r] = hashCell(client[r], getClientCell(r, c));
+		}
+		unchanged += (target[r] == client[r]);
+	}
+
+	int best = 0;
+	unsigned bestMatches = unchanged;
+	for(int lines = 1; lines < rows; ++lines) {
+		unsigned up = 0;
+		unsigned down = 0;
+		for(int r = 0; r < rows; ++r) {
+			up += target[r] == ((r + lines < rows) ? client[r + lines] : blank);
+			down += target[r] == ((r >= lines) ? client[r - lines] : blank);
+		}
+		if(up > bestMatches) {
+			best = lines;
+			bestMatches = up;
+		}
+		if(down > bestMatches) {
+			best = -lines;
+			bestMatches = down;
+		}
+	}
+
+	delete[] hashes;
+	return best;
+}
+
+} // namespace
+
+size_t Terminal::saveState(uint8_t* buffer, size_t size, const uint8_t* base, size_t baseSize) const
+{
+	if(!gridEnabled) {
+		return 0;
+	}
+
+	// A delta needs the base cells, which are read alongside the current ones
+	Reader baseReader(base, baseSize);
+	SnapshotStyles baseStyles;
+	SnapshotChars baseChars;
+	RunReader baseRuns(baseReader);
+	if(base != nullptr) {
+		Header header;
+		if(!readHeader(baseReader, base, baseSize, header) || header.type != typeFull || header.cols != colCount ||
+		   header.rows != rowCount) {
+			return 0;
+		}
+		readScreenState(baseReader);
+		if(!baseStyles.read(baseReader) || !baseChars.read(baseReader)) {
+			return 0;
+		}
+	}
+
+	Writer writer(buffer, size);
+	writer.u16(magic);
+	writer.u8(version);
+	writer.u8(base ? typeDelta : typeFull);
+	writer.u16(colCount);
+	writer.u16(rowCount);
+	if(base != nullptr) {
+		writer.u32(getChecksum(base, baseSize));
+	}
+
+	writer.u8(flags.val);
+	writer.u16(cursorPos.col);
+	writer.u16(cursorPos.row);
+	writer.u16(savedCursorPos.col);
+	writer.u16(savedCursorPos.row);
+	writer.u16(scrollStartRow);
+	writer.u16(scrollEndRow);
+	writer.style(style);
+	writer.u8(uint8_t(state));
+	writer.u8(args.count);
+	for(unsigned i = 0; i < args.count; ++i) {
+		writer.u16(args.values[i]);
+	}
+	writer.u8(args.intermediateCount);
+	for(unsigned i = 0; i < args.intermediateCount; ++i) {
+		writer.u8(args.intermediates[i]);
+	}
+	writer.u8(args.overflow);
+	auto decoder = utf8.save();
+	writer.u32(decoder.codepoint);
+	writer.u8(decoder.remaining);
+	writer.u8(decoder.length);
+
+	// Only styles and characters in use
+	uint32_t used[StyleTable::bitmapWords] = {};
+	uint32_t usedChars[CharTable::bitmapWords] = {};
+	auto cells = grid.row(0);
+	unsigned cellCount = colCount * rowCount;
+	for(unsigned i = 0; i < cellCount; ++i) {
+		StyleTable::mark(used, cells[i].attr);
+		CharTable::mark(usedChars, cells[i].ch);
+	}
+	unsigned styleCount = 0;
+	for(unsigned id = 0; id < StyleTable::maxStyles; ++id) {
+		styleCount += StyleTable::isMarked(used, id);
+	}
+	writer.u8(styleCount);
+	for(unsigned id = 0; id < StyleTable::maxStyles; ++id) {
+		if(StyleTable::isMarked(used, id)) {
+			writer.u8(id);
+			writer.style(styles[id]);
+		}
+	}
+	unsigned charCount = 0;
+	for(unsigned i = 0; i < CharTable::maxChars; ++i) {
+		charCount += CharTable::isMarked(usedChars, CharTable::firstId + i);
+	}
+	writer.u8(charCount);
+	for(unsigned i = 0; i < CharTable::maxChars; ++i) {
+		uint8_t id = CharTable::firstId + i;
+		if(CharTable::isMarked(usedChars, id)) {
+			writer.u8(id);
+			writer.u32(chars.getCodepoint(id));
+		}
+	}
+
+	{
+		RunWriter runs(writer);
+		for(unsigned i = 0; i < cellCount; ++i) {
+			if(base != nullptr) {
+				Cell baseCell;
+				baseRuns.next(baseCell);
+				if(chars.getCodepoint(cells[i].ch) == baseChars[baseCell.ch] &&
+				   styles[cells[i].attr] == baseStyles[baseCell.attr]) {
+					runs.skip();
+					continue;
+				}
+			}
+			runs.put(cells[i]);
+		}
+	}
+	if(baseReader.error) {
+		return 0;
+	}
+
+	writer.checksum();
+	return writer.pos;
+}
+
+bool Terminal::restoreState(const uint8_t* data, size_t size, const uint8_t* base, size_t baseSize)
+{
+	if(!gridEnabled) {
+		return false;
+	}
+
+	Reader reader(data, size);
+	Header header;
+	if(!readHeader(reader, data, size, header) || header.cols != colCount || header.rows != rowCount) {
+		return false;
+	}
+
+	Reader baseReader(base, baseSize);
+	RunReader baseRuns(baseReader);
+	SnapshotStyles baseStyles;
+	SnapshotChars baseChars;
+	if(header.type == typeDelta) {
+		Header baseHeader;
+		if(!readHeader(baseReader, base, baseSize, baseHeader) || baseHeader.type != typeFull ||
+		   getChecksum(base, baseSize) != header.baseChecksum) {
+			return false;
+		}
+		readScreenState(baseReader);
+		if(!baseStyles.read(baseReader) || !baseChars.read(baseReader)) {
+			return false;
+		}
+	}
+
+	// Read everything into temporaries first, so a bad snapshot leaves the terminal alone
+	Flags newFlags;
+	newFlags.val = reader.u8();
+	Pos newCursor{reader.u16(), reader.u16()};
+	Pos newSaved{reader.u16(), reader.u16()};
+	uint16_t newScrollStart = reader.u16();
+	uint16_t newScrollEnd = reader.u16();
+	Style newStyle = reader.style();
+	uint8_t newState = reader.u8();
+	Args newArgs{};
+	newArgs.count = reader.u8();
+	if(newArgs.count > Args::maxCount) {
+		return false;
+	}
+	for(unsigned i = 0; i < newArgs.count; ++i) {
+		newArgs.values[i] = reader.u16();
+	}
+	newArgs.intermediateCount = reader.u8();
+	if(newArgs.intermediateCount > Args::maxIntermediates) {
+		return false;
+	}
+	for(unsigned i = 0; i < newArgs.intermediateCount; ++i) {
+		newArgs.intermediates[i] = reader.u8();
+	}
+	newArgs.overflow = reader.u8();
+	Utf8Decoder::SavedState decoder;
+	decoder.codepoint = reader.u32();
+	decoder.remaining = reader.u8();
+	decoder.length = reader.u8();
+
+	SnapshotStyles newStyles;
+	SnapshotChars newChars;
+	if(reader.error || !newStyles.read(reader) || !newChars.read(reader) || newCursor.col > colCount ||
+	   newCursor.row >= rowCount || newSaved.col > colCount || newSaved.row >= rowCount ||
+	   newScrollStart > newScrollEnd || newScrollEnd >= rowCount || newState >= Parser::stateCount ||
+	   !utf8.restore(decoder)) {
+		return false;
+	}
+
+	flags = newFlags;
+	cursorPos = newCursor;
+	savedCursorPos = newSaved;
+	scrollStartRow = newScrollStart;
+	scrollEndRow = newScrollEnd;
+	state = State(newState);
+	args = newArgs;
+
+	// Cells get new style and character IDs as they are restored
+	Attr newIds[StyleTable::maxStyles];
+	Attr baseIds[StyleTable::maxStyles];
+	memset(newIds, StyleTable::invalid, sizeof(newIds));
+	memset(baseIds, StyleTable::invalid, sizeof(baseIds));
+	auto getId = [&](Attr* ids, const SnapshotStyles& table, Attr attr) -> Attr {
+		if(attr >= StyleTable::maxStyles) {
+			return 0;
+		}
+		if(ids[attr] == StyleTable::invalid) {
+			ids[attr] = styles.intern(table[attr]);
+		}
+		return (ids[attr] == StyleTable::invalid) ? 0 : ids[attr];
+	};
+	uint8_t newCharIds[CharTable::maxChars] = {};
+	uint8_t baseCharIds[CharTable::maxChars] = {};
+	auto getChar = [&](uint8_t* ids, const SnapshotChars& table, uint8_t ch) -> uint8_t {
+		if(ch < CharTable::firstId) {
+			return ch;
+		}
+		if(!CharTable::isId(ch)) {
+			return CharTable::firstId;
+		}
+		auto& id = ids[ch - CharTable::firstId];
+		if(id == CharTable::invalid) {
+			auto codepoint = table[ch];
+			id = chars.intern(codepoint, display.mapCodepoint(codepoint));
+		}
+		return (id == CharTable::invalid) ? CharTable::firstId : id;
+	};
+
+	styles.reset();
+	chars.reset(display.mapCodepoint(Utf8Decoder::replacement));
+	RunReader runs(reader);
+	auto cells = grid.row(0);
+	unsigned cellCount = colCount * rowCount;
+	bool skipped = false;
+	for(unsigned i = 0; i < cellCount; ++i) {
+		Cell cell;
+		Cell baseCell{};
+		if(header.type == typeDelta) {
+			baseRuns.next(baseCell);
+		}
+		if(runs.next(cell)) {
+			cell.ch = getChar(newCharIds, newChars, cell.ch);
+			cell.attr = getId(newIds, newStyles, cell.attr);
+		} else {
+			skipped = true;
+			cell.ch = getChar(baseCharIds, baseChars, baseCell.ch);
+			cell.attr = getId(baseIds, baseStyles, baseCell.attr);
+		}
+		cells[i] = cell;
+	}
+
+	if(reader.error || baseReader.error || reader.pos + checksumSize != size ||
+	   (skipped && header.type != typeDelta)) {
+		// Cells are inconsistent with the rest of the state
+		reset();
+		return false;
+	}
+
+	// Redraw everything
+	setStyle(newStyle);
+	viewOffset = 0;
+	pendingScroll.lines = 0;
+	grid.invalidate();
+	if(!isFramePaced()) {
+		flush();
+	}
+	return true;
+}
+
+size_t Terminal::getRepaint(char* buffer, size_t size, const uint8_t* base, size_t baseSize) const
+{
+	if(!gridEnabled) {
+		return 0;
+	}
+
+	Reader baseReader(base, baseSize);
+	RunReader baseRuns(baseReader);
+	SnapshotStyles baseStyles;
+	SnapshotChars baseChars;
+	ScreenState client{};
+	if(base != nullptr) {
+		Header header;
+		if(!readHeader(baseReader, base, baseSize, header) || header.type != typeFull || header.cols != colCount ||
+		   header.rows != rowCount) {
+			return 0;
+		}
+		client = readScreenState(baseReader);
+		if(!baseStyles.read(baseReader) || !baseChars.read(baseReader)) {
+			return 0;
+		}
+	}
+
+	// What the other terminal has, with IDs from the base style table
+	unsigned cellCount = colCount * rowCount;
+	auto clientCells = new(std::nothrow) Cell[cellCount];
+	if(clientCells == nullptr) {
+		return 0;
+	}
+	for(unsigned i = 0; i < cellCount; ++i) {
+		clientCells[i] = Cell{' ', 0};
+		if(base != nullptr) {
+			baseRuns.next(clientCells[i]);
+		}
+	}
+	if(baseReader.error) {
+		delete[] clientCells;
+		return 0;
+	}
+	auto getClientCell = [&](unsigned row, unsigned col) {
+		auto& cell = clientCells[row * colCount + col];
+		return RepaintCell{baseChars[cell.ch], baseStyles[cell.attr]};
+	};
+	auto getCell = [&](unsigned row, unsigned col) {
+		auto& cell = grid.row(row)[col];
+		return RepaintCell{chars.getCodepoint(cell.ch), styles[cell.attr]};
+	};
+
+	Writer writer(reinterpret_cast<uint8_t*>(buffer), size);
+	Repainter out(writer, colCount, rowCount);
+
+	// Draw without autowrap, a scroll region or origin mode
+	if(base == nullptr) {
+		out.send("\x1b[?6l\x1b[?7l\x1b[r\x1b[m\x1b[2J");
+		out.setKnown(0, 0, defaultStyle);
+		out.cursorMoved();
+	} else {
+		Flags clientFlags;
+		clientFlags.val = client.flags;
+		out.setKnown(client.cursorRow, client.cursorCol, client.style);
+		if(clientFlags.origin_mode) {
+			out.send("\x1b[?6l");
+			out.cursorMoved();
+		}
+		if(client.scrollStart != 0 || client.scrollEnd != rowCount - 1) {
+			out.send("\x1b[r");
+			out.cursorMoved();
+		}
+		if(clientFlags.cursor_wrap) {
+			out.send("\x1b[?7l");
+		}
+
+		// If the screen has scrolled, scroll the other terminal to match rather than redraw every line
+		int lines = findScroll(colCount, rowCount, getCell, getClientCell);
+		if(lines != 0) {
+			out.setStyle(defaultStyle);
+			if(lines > 0) {
+				out.moveTo(rowCount - 1, 0);
+				for(int i = 0; i < lines; ++i) {
+					out.send("\n");
+				}
+				memmove(clientCells, &clientCells[lines * colCount], (rowCount - lines) * colCount * sizeof(Cell));
+				std::fill_n(&clientCells[(rowCount - lines) * colCount], lines * colCount, Cell{' ', 0});
+			} else {
+				out.moveTo(0, 0);
+				for(int i = 0; i < -lines; ++i) {
+					out.send("\x1bM");
+				}
+				memmove(&clientCells[-lines * colCount], clientCells, (rowCount + lines) * colCount * sizeof(Cell));
+				std::fill_n(clientCells, -lines * colCount, Cell{' ', 0});
+			}
+		}
+	}
+
+	auto row = new(std::nothrow) RepaintCell[colCount];
+	if(row == nullptr) {
+		delete[] clientCells;
+		return 0;
+	}
+
+	for(unsigned r = 0; r < rowCount; ++r) {
+		for(unsigned c = 0; c < colCount; ++c) {
+			row[c] = getCell(r, c);
+		}
+
+		// Blanks at the end of the row which can be done with an erase
+		unsigned tail = colCount;
+		RepaintCell blank = row[colCount - 1];
+		if(blank.ch == ' ' && blank.style == blank.style.getEraseStyle()) {
+			while(tail > 0 && !(row[tail - 1] != blank)) {
+				--tail;
+			}
+		}
+		unsigned tailChanges = 0;
+		for(unsigned c = tail; c < colCount; ++c) {
+			tailChanges += (row[c] != getClientCell(r, c));
+		}
+		unsigned end = (tailChanges > 1) ? tail : colCount;
+
+		for(unsigned c = 0; c < end; ++c) {
+			// A wide character is sent once, covering its continuation cell as well
+			bool wide = (c + 1 < colCount && row[c + 1].ch == Display::wideContinuation);
+			if(row[c] != getClientCell(r, c) || (wide && row[c + 1] != getClientCell(r, c + 1))) {
+				out.moveTo(r, c, row);
+				out.setStyle(row[c].style);
+				out.put(row[c].ch, wide ? 2 : 1);
+			}
+			c += wide;
+		}
+		if(end < colCount) {
+			out.moveTo(r, end, row);
+			out.setStyle(blank.style);
+			out.send("\x1b[K");
+		}
+	}
+
+	delete[] row;
+	delete[] clientCells;
+
+	// Saved cursor
+	if(base != nullptr ? (savedCursorPos.col != client.savedCol || savedCursorPos.row != client.savedRow)
+					   : (savedCursorPos.col != 0 || savedCursorPos.row != 0)) {
+		out.moveTo(savedCursorPos.row, std::min(savedCursorPos.col, uint16_t(colCount - 1)));
+		out.send("\x1b" "7");
+	}
+
+	// Modes, which may move the cursor
+	if(scrollStartRow != 0 || scrollEndRow != rowCount - 1) {
+		Sequence seq;
+		seq.add("\x1b[");
+		seq.number(scrollStartRow + 1);
+		seq.add(';');
+		seq.number(scrollEndRow + 1);
+		seq.add('r');
+		out.send(seq);
+		out.cursorMoved();
+	}
+
+	/*
+	 * Cursor. It may be past the last column, which is only reached by writing there.
+	 * Neither DECSTBM nor DECOM moves the cursor here, so it may also be outside the scroll region
+	 * in origin mode. CUP can't reach it then, so it is placed before origin mode is set.
+	 */
+	auto cells = grid.row(cursorPos.row);
+	bool pastEnd = (cursorPos.col >= colCount);
+	uint16_t col = pastEnd ? colCount - 1 : cursorPos.col;
+	// A wide character at the end of the row is written whole
+	unsigned width = 1;
+	if(pastEnd && col > 0 && cells[col].ch == Display::wideContinuation) {
+		--col;
+		width = 2;
+	}
+	bool inRegion = (cursorPos.row >= scrollStartRow && cursorPos.row <= scrollEndRow);
+	if(flags.origin_mode && inRegion) {
+		out.send("\x1b[?6h");
+		Sequence seq;
+		seq.add("\x1b[");
+		seq.number(cursorPos.row - scrollStartRow + 1);
+		seq.add(';');
+		seq.number(col + 1);
+		seq.add('H');
+		out.send(seq);
+		out.setKnown(cursorPos.row, col, out.getStyle());
+	} else {
+		out.moveTo(cursorPos.row, col);
+	}
+	if(pastEnd) {
+		out.setStyle(styles[cells[col].attr]);
+		out.put(chars.getCodepoint(cells[col].ch), width);
+	}
+	if(flags.origin_mode && !inRegion) {
+		out.send("\x1b[?6h");
+	}
+
+	out.setStyle(style);
+	if(flags.cursor_wrap) {
+		out.send("\x1b[?7h");
+	}
+
+	return writer.pos;
+}
+
+} // namespace VT100
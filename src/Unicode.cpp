@@ -0,0 +1,187 @@
+/**
+	This file is part of FORTMAX.
+
+	FORTMAX is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+
+#include "include/VT100/Unicode.h"
+
+namespace VT100
+{
+namespace
+{
+struct Range {
+	uint32_t first;
+	uint32_t last;
+};
+
+// Sorted ranges, searched by bisection
+
+const Range zeroWidth[] = {
+	{0x0080, 0x009f}, {0x0300, 0x036f}, {0x0483, 0x0489}, {0x0591, 0x05bd}, {0x0610, 0x061a},
+	{0x064b, 0x065f}, {0x0e31, 0x0e31}, {0x0e34, 0x0e3a}, {0x0e47, 0x0e4e}, {0x1ab0, 0x1aff},
+	{0x1dc0, 0x1dff}, {0x200b, 0x200f}, {0x2028, 0x202e}, {0x2060, 0x2064}, {0x20d0, 0x20ff},
+	{0xfe00, 0xfe0f}, {0xfe20, 0xfe2f}, {0xfeff, 0xfeff}, {0xe0100, 0xe01ef},
+};
+
+// East Asian Wide and Fullwidth, plus emoji presentation
+const Range wide[] = {
+	{0x1100, 0x115f},   {0x231a, 0x231b},   {0x2329, 0x232a},   {0x23e9, 0x23ec},   {0x23f0, 0x23f0},
+	{0x23f3, 0x23f3},   {0x25fd, 0x25fe},   {0x2614, 0x2615},   {0x2648, 0x2653},   {0x267f, 0x267f},
+	{0x2693, 0x2693},   {0x26a1, 0x26a1},   {0x26aa, 0x26ab},   {0x26bd, 0x26be},   {0x26c4, 0x26c5},
+	{0x26ce, 0x26ce},   {0x26d4, 0x26d4},   {0x26ea, 0x26ea},   {0x26f2, 0x26f3},   {0x26f5, 0x26f5},
+	{0x26fa, 0x26fa},   {0x26fd, 0x26fd},   {0x2705, 0x2705},   {0x270a, 0x270b},   {0x2728, 0x2728},
+	{0x274c, 0x274c},   {0x274e, 0x274e},   {0x2753, 0x2755},   {0x2757, 0x2757},   {0x2795, 0x2797},
+	{0x27b0, 0x27b0},   {0x27bf, 0x27bf},   {0x2b1b, 0x2b1c},   {0x2b50, 0x2b50},   {0x2b55, 0x2b55},
+	{0x2e80, 0x303e},   {0x3041, 0x33ff},   {0x3400, 0x4dbf},   {0x4e00, 0x9fff},   {0xa000, 0xa4cf},
+	{0xa960, 0xa97f},   {0xac00, 0xd7a3},   {0xf900, 0xfaff},   {0xfe10, 0xfe19},   {0xfe30, 0xfe6f},
+	{0xff00, 0xff60},   {0xffe0, 0xffe6},   {0x16fe0, 0x16fe4}, {0x17000, 0x18cff}, {0x1b000, 0x1b2ff},
+	{0x1f004, 0x1f004}, {0x1f0cf, 0x1f0cf}, {0x1f18e, 0x1f18e}, {0x1f191, 0x1f19a}, {0x1f200, 0x1f251},
+	{0x1f300, 0x1f64f}, {0x1f680, 0x1f6ff}, {0x1f7e0, 0x1f7eb}, {0x1f90c, 0x1f9ff}, {0x1fa70, 0x1faff},
+	{0x20000, 0x2fffd}, {0x30000, 0x3fffd},
+};
+
+template <size_t count> bool contains(const Range (&ranges)[count], uint32_t codepoint)
+{
+	if(codepoint < ranges[0].first || codepoint > ranges[count - 1].last) {
+		return false;
+	}
+	unsigned low = 0;
+	unsigned high = count;
+	while(low < high) {
+		unsigned mid = (low + high) / 2;
+		if(codepoint > ranges[mid].last) {
+			low = mid + 1;
+		} else if(codepoint < ranges[mid].first) {
+			high = mid;
+		} else {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+uint32_t Utf8Decoder::decode(uint8_t c)
+{
+	if(remaining != 0) {
+		if((c & 0xc0) != 0x80) {
+			remaining = 0;
+			return interrupted;
+		}
+		codepoint = (codepoint << 6) | (c & 0x3f);
+		if(--remaining != 0) {
+			return pending;
+		}
+
+		// Reject overlong encodings, surrogates and values beyond Unicode
+		static const uint32_t minValues[] = {0, 0, 0x80, 0x800, 0x10000};
+		if(codepoint < minValues[length] || (codepoint >= 0xd800 && codepoint <= 0xdfff) || codepoint > 0x10ffff) {
+			return replacement;
+		}
+		return codepoint;
+	}
+
+	if(c < 0x80) {
+		return c;
+	}
+	if((c & 0xe0) == 0xc0) {
+		codepoint = c & 0x1f;
+		length = 2;
+	} else if((c & 0xf0) == 0xe0) {
+		codepoint = c & 0x0f;
+		length = 3;
+	} else if((c & 0xf8) == 0xf0) {
+		codepoint = c & 0x07;
+		length = 4;
+	} else {
+		// Continuation byte without a lead, or not valid in UTF-8
+		return replacement;
+	}
+	remaining = length - 1;
+	return pending;
+}
+
+unsigned getCodepointWidth(uint32_t codepoint)
+{
+	if(codepoint < 0x0300) {
+		return (codepoint >= 0x80 && codepoint < 0xa0) ? 0 : 1;
+	}
+	if(contains(zeroWidth, codepoint)) {
+		return 0;
+	}
+	return contains(wide, codepoint) ? 2 : 1;
+}
+
+unsigned encodeUtf8(uint32_t codepoint, char* buffer)
+{
+	if(codepoint < 0x80) {
+		buffer[0] = codepoint;
+		return 1;
+	}
+	unsigned length = (codepoint < 0x800) ? 2 : (codepoint < 0x10000) ? 3 : 4;
+	static const uint8_t leads[] = {0, 0, 0xc0, 0xe0, 0xf0};
+	for(unsigned i = length - 1; i > 0; --i) {
+		buffer[i] = 0x80 | (codepoint & 0x3f);
+		codepoint >>= 6;
+	}
+	buffer[0] = leads[length] | codepoint;
+	return length;
+}
+
+void CharTable::reset(uint8_t replacementGlyph)
+{
+	memset(allocated, 0, sizeof(allocated));
+	codepoints[0] = Utf8Decoder::replacement;
+	glyphs[0] = replacementGlyph;
+	mark(allocated, firstId);
+}
+
+uint8_t CharTable::intern(uint32_t codepoint, uint8_t glyph)
+{
+	int freeSlot = -1;
+	for(unsigned i = 0; i < maxChars; ++i) {
+		if(!isMarked(allocated, firstId + i)) {
+			if(freeSlot < 0) {
+				freeSlot = i;
+			}
+		} else if(codepoints[i] == codepoint) {
+			return firstId + i;
+		}
+	}
+
+	if(freeSlot < 0) {
+		return invalid;
+	}
+
+	codepoints[freeSlot] = codepoint;
+	glyphs[freeSlot] = glyph;
+	mark(allocated, firstId + freeSlot);
+	return firstId + freeSlot;
+}
+
+void CharTable::collect(const uint32_t* used)
+{
+	for(unsigned i = 0; i < bitmapWords; ++i) {
+		allocated[i] &= used[i];
+	}
+	mark(allocated, firstId);
+}
+
+} // namespace VT100
@@ -0,0 +1,92 @@
+/**
+ * BasicTerminal.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Terminal.h"
+
+namespace VT100
+{
+/**
+ * @brief Optional parts of a BasicTerminal, combined as a bitmask
+ */
+enum TerminalFeature : unsigned {
+	// Shadow copy of the screen, needed for frame pacing, snapshots, repaints and scrollback
+	featureCellGrid = 0x01,
+	// Queue for input from an interrupt handler, see Terminal::pump()
+	featureInputRing = 0x02,
+};
+
+/**
+ * @brief Terminal with its size and storage fixed at compile time
+ * @tparam Rows, Cols Screen size in characters, used regardless of the display size
+ * @tparam Features Bitmask of TerminalFeature values
+ * @tparam InputSize Size of the input ring, a power of 2 and at least 16
+ *
+ * The cell grid and input ring live inside the object, so a statically allocated BasicTerminal
+ * has its memory use fixed at link time and never touches the heap. Scrollback, if enabled,
+ * still uses the heap or the given allocator.
+ */
+template <uint16_t Rows, uint16_t Cols, unsigned Features = featureCellGrid, size_t InputSize = 256>
+class BasicTerminal : public Terminal
+{
+public:
+	static_assert(Rows != 0 && Cols != 0, "Screen size must not be zero");
+	static_assert(InputSize >= 16 && (InputSize & (InputSize - 1)) == 0, "InputSize must be a power of 2, at least 16");
+
+	static constexpr bool hasCellGrid = (Features & featureCellGrid) != 0;
+	static constexpr bool hasInputRing = (Features & featureInputRing) != 0;
+
+	BasicTerminal(Display& display, Callbacks& callbacks) : Terminal(display, callbacks)
+	{
+		setFixedSize(Cols, Rows, gridStorage.cells, gridStorage.dirty);
+		if(hasCellGrid) {
+			enableCellGrid(true);
+		}
+		if(hasInputRing) {
+			enableInputRing(inputStorage.buffer, InputSize);
+		}
+	}
+
+private:
+	template <bool enabled, typename dummy = void> struct GridStorage {
+		Cell cells[Rows * Cols];
+		CellGrid::Span dirty[Rows];
+	};
+
+	template <typename dummy> struct GridStorage<false, dummy> {
+		static constexpr Cell* cells = nullptr;
+		static constexpr CellGrid::Span* dirty = nullptr;
+	};
+
+	template <bool enabled, typename dummy = void> struct InputStorage {
+		uint8_t buffer[InputSize];
+	};
+
+	template <typename dummy> struct InputStorage<false, dummy> {
+		static constexpr uint8_t* buffer = nullptr;
+	};
+
+	GridStorage<hasCellGrid> gridStorage;
+	InputStorage<hasInputRing> inputStorage;
+};
+
+} // namespace VT100
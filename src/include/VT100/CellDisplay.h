@@ -0,0 +1,121 @@
+/**
+ * CellDisplay.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Display.h"
+
+namespace VT100
+{
+/**
+ * @brief Headless display which records characters and colours, one unit per character cell
+ *
+ * Use where the screen content is needed rather than pixels, e.g. to mirror a console.
+ * Underlines are not recorded.
+ */
+class CellDisplay : public Display
+{
+public:
+	CellDisplay(uint16_t cols, uint16_t rows);
+
+	~CellDisplay()
+	{
+		delete[] chars;
+		delete[] attrs;
+	}
+
+	bool isAllocated() const
+	{
+		return chars != nullptr && attrs != nullptr;
+	}
+
+	void drawString(uint16_t x, uint16_t y, const char* text) override;
+	void drawChar(uint16_t x, uint16_t y, uint8_t c) override;
+	void drawCells(uint16_t x, uint16_t y, const uint8_t* chars, const CellAttr* attrs, size_t count) override;
+
+	void setBackColor(uint16_t col) override
+	{
+		current.backColor = col;
+	}
+
+	void setFrontColor(uint16_t col) override
+	{
+		current.frontColor = col;
+	}
+
+	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) override;
+	void scroll(uint16_t top, uint16_t bottom, int16_t diff) override;
+	bool copyRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t destX, uint16_t destY) override;
+
+	uint16_t getWidth() override
+	{
+		return colCount;
+	}
+
+	uint16_t getHeight() override
+	{
+		return rowCount;
+	}
+
+	uint8_t getCharWidth() override
+	{
+		return 1;
+	}
+
+	uint8_t getCharHeight() override
+	{
+		return 1;
+	}
+
+	uint16_t getColumnCount() const
+	{
+		return colCount;
+	}
+
+	uint16_t getRowCount() const
+	{
+		return rowCount;
+	}
+
+	// Characters, row by row
+	const uint8_t* getChars() const
+	{
+		return chars;
+	}
+
+	// Colours, row by row
+	const CellAttr* getAttrs() const
+	{
+		return attrs;
+	}
+
+private:
+	// Clip an area to the screen, returning false if nothing is left
+	bool clip(uint16_t x, uint16_t y, uint16_t& w, uint16_t& h) const;
+
+	uint8_t* chars;
+	CellAttr* attrs;
+	uint16_t colCount;
+	uint16_t rowCount;
+	CellAttr current{0xffff, 0};
+};
+
+} // namespace VT100
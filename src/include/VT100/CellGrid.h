@@ -0,0 +1,169 @@
+/**
+ * CellGrid.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace VT100
+{
+// Cell attribute: ID of a style held in a StyleTable
+using Attr = uint8_t;
+
+// Character is ASCII, a CharTable ID or Display::wideContinuation
+struct Cell {
+	uint8_t ch;
+	Attr attr;
+
+	bool operator==(const Cell& other) const
+	{
+		return ch == other.ch && attr == other.attr;
+	}
+
+	bool operator!=(const Cell& other) const
+	{
+		return !operator==(other);
+	}
+};
+
+/*
+ * Shadow copy of what is on screen, with a dirty column span per row.
+ *
+ * Cells are only marked dirty when their content actually changes, so repainting
+ * identical content costs nothing when the grid is flushed to the display.
+ */
+class CellGrid
+{
+public:
+	// Column range [start, end) which differs from the display
+	struct Span {
+		uint16_t start;
+		uint16_t end;
+
+		bool empty() const
+		{
+			return start >= end;
+		}
+	};
+
+	~CellGrid()
+	{
+		free();
+	}
+
+	bool resize(uint16_t cols, uint16_t rows);
+	void free();
+
+	/**
+	 * @brief Use caller-owned memory instead of the heap
+	 * @param cells At least cols * rows entries
+	 * @param dirty At least rows entries
+	 * @note resize() then only succeeds for this size
+	 */
+	void setStorage(Cell* cells, Span* dirty, uint16_t cols, uint16_t rows)
+	{
+		free();
+		storage = {cells, dirty, cols, rows};
+	}
+
+	bool isAllocated() const
+	{
+		return cells != nullptr;
+	}
+
+	uint16_t getColumnCount() const
+	{
+		return colCount;
+	}
+
+	uint16_t getRowCount() const
+	{
+		return rowCount;
+	}
+
+	Cell* row(uint16_t row)
+	{
+		return &cells[row * colCount];
+	}
+
+	const Cell* row(uint16_t row) const
+	{
+		return &cells[row * colCount];
+	}
+
+	// Returns true if cell content was changed
+	bool set(uint16_t col, uint16_t row, Cell cell);
+
+	// Fill columns [startCol, endCol) of a row
+	void fill(uint16_t row, uint16_t startCol, uint16_t endCol, Cell cell);
+
+	// Fill an entire row, forcing a redraw regardless of content
+	void reset(uint16_t row, Cell cell);
+
+	/*
+	 * Move rows within region [top, bottom] up (lines > 0) or down (lines < 0).
+	 * Dirty spans move with their rows; exposed rows are reset to `fill`.
+	 */
+	void scroll(uint16_t top, uint16_t bottom, int16_t lines, Cell fill);
+
+	/*
+	 * Move cells from startCol to the end of a row right (count > 0) or left (count < 0).
+	 * Cells moved past the end are lost, vacated cells are set to `fill`.
+	 */
+	void shift(uint16_t row, uint16_t startCol, int16_t count, Cell fill);
+
+	void markDirty(uint16_t row, uint16_t startCol, uint16_t endCol);
+
+	void invalidate()
+	{
+		for(unsigned r = 0; r < rowCount; ++r) {
+			dirty[r] = {0, colCount};
+		}
+	}
+
+	const Span& getDirty(uint16_t row) const
+	{
+		return dirty[row];
+	}
+
+	void clearDirty(uint16_t row)
+	{
+		dirty[row] = {};
+	}
+
+	bool isDirty() const;
+
+private:
+	struct Storage {
+		Cell* cells;
+		Span* dirty;
+		uint16_t cols;
+		uint16_t rows;
+	};
+
+	Cell* cells{nullptr};
+	Span* dirty{nullptr};
+	uint16_t colCount{0};
+	uint16_t rowCount{0};
+	Storage storage{};
+};
+
+} // namespace VT100
@@ -26,24 +26,103 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 namespace VT100
 {
+/**
+ * @brief Colours for drawing one character cell
+ */
+struct CellAttr {
+	uint16_t frontColor;
+	uint16_t backColor;
+
+	bool operator==(const CellAttr& other) const
+	{
+		return frontColor == other.frontColor && backColor == other.backColor;
+	}
+
+	bool operator!=(const CellAttr& other) const
+	{
+		return !operator==(other);
+	}
+};
+
 class Display
 {
 public:
+	// Character code for the right half of a double-width character
+	static constexpr uint8_t wideContinuation = 0;
+
 	virtual void drawString(uint16_t x, uint16_t y, const char* text) = 0;
 	virtual void drawChar(uint16_t x, uint16_t y, uint8_t c) = 0;
+
+	/**
+	 * @brief Draw a row of character cells starting at (x, y)
+	 * @param chars One character per cell. Displays with double-width glyphs may draw these
+	 * across the following `wideContinuation` cell, otherwise it shows as a blank.
+	 * @param attrs Colours for each cell
+	 * @param count Number of cells
+	 * @note Backends which can stream pixels into a window should override this so the
+	 * window only needs setting up once. The default implementation calls drawChar().
+	 */
+	virtual void drawCells(uint16_t x, uint16_t y, const uint8_t* chars, const CellAttr* attrs, size_t count)
+	{
+		drawCellRun(*this, x, y, getCharWidth(), chars, attrs, count);
+	}
+
 	virtual void setBackColor(uint16_t col) = 0;
 	virtual void setFrontColor(uint16_t col) = 0;
 	virtual void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) = 0;
 
 	virtual void scroll(uint16_t top, uint16_t bottom, int16_t diff) = 0;
 
+	/**
+	 * @brief Copy a block of pixels to another position on the display
+	 * @param x, y, w, h Area to copy
+	 * @param destX, destY New position for the top-left corner, areas may overlap
+	 * @retval bool false if not supported, in which case the terminal redraws instead
+	 * @note Used for inserting and deleting characters within a line
+	 */
+	virtual bool copyRect(uint16_t /*x*/, uint16_t /*y*/, uint16_t /*w*/, uint16_t /*h*/, uint16_t /*destX*/,
+						  uint16_t /*destY*/)
+	{
+		return false;
+	}
+
+	/**
+	 * @brief Get the font character to draw for a Unicode codepoint
+	 * @note The default only maps ASCII, showing '?' for anything else
+	 */
+	virtual uint8_t mapCodepoint(uint32_t codepoint)
+	{
+		return (codepoint >= 0x20 && codepoint < 0x7f) ? codepoint : '?';
+	}
+
 	virtual uint16_t getWidth() = 0;
 	virtual uint16_t getHeight() = 0;
 	virtual uint8_t getCharWidth() = 0;
 	virtual uint8_t getCharHeight() = 0;
+
+protected:
+	/**
+	 * @brief Draw cells one character at a time, setting colours only where they change
+	 * @param target Anything with setFrontColor(), setBackColor() and drawChar(), so a backend
+	 * can pass itself by its own type and have the calls inlined
+	 */
+	template <class Target>
+	static void drawCellRun(Target& target, uint16_t x, uint16_t y, uint8_t charWidth, const uint8_t* chars,
+							const CellAttr* attrs, size_t count)
+	{
+		for(size_t i = 0; i < count; ++i) {
+			if(i == 0 || attrs[i] != attrs[i - 1]) {
+				target.setFrontColor(attrs[i].frontColor);
+				target.setBackColor(attrs[i].backColor);
+			}
+			target.drawChar(x, y, (chars[i] == wideContinuation) ? ' ' : chars[i]);
+			x += charWidth;
+		}
+	}
 };
 
 } // namespace VT100
@@ -0,0 +1,116 @@
+/**
+ * DisplayAdapter.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Display.h"
+#include <utility>
+
+namespace VT100
+{
+/**
+ * @brief Implements the Display interface on top of a backend with no virtual methods
+ * @tparam Backend Provides these as ordinary (ideally inline) methods:
+ *
+ * 	void drawChar(uint16_t x, uint16_t y, uint8_t c);
+ * 	void setFrontColor(uint16_t col);
+ * 	void setBackColor(uint16_t col);
+ * 	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+ * 	void scroll(uint16_t top, uint16_t bottom, int16_t diff);
+ * 	uint16_t getWidth();
+ * 	uint16_t getHeight();
+ * 	uint8_t getCharWidth();
+ * 	uint8_t getCharHeight();
+ *
+ * The terminal makes one virtual call per run of characters, through drawCells() or drawString().
+ * The loop over each character, with its colour changes, is compiled here against the backend type
+ * so those calls can be inlined, rather than being virtual calls per glyph as with the default
+ * Display::drawCells(). Both use the same Display::drawCellRun() loop.
+ * Derive from the adapter to override copyRect() or mapCodepoint().
+ */
+template <class Backend> class DisplayAdapter : public Display, public Backend
+{
+public:
+	template <typename... Args> DisplayAdapter(Args&&... args) : Backend(std::forward<Args>(args)...)
+	{
+	}
+
+	void drawString(uint16_t x, uint16_t y, const char* text) override
+	{
+		auto charWidth = Backend::getCharWidth();
+		for(; *text != '\0'; ++text) {
+			Backend::drawChar(x, y, *text);
+			x += charWidth;
+		}
+	}
+
+	void drawChar(uint16_t x, uint16_t y, uint8_t c) override
+	{
+		Backend::drawChar(x, y, c);
+	}
+
+	void drawCells(uint16_t x, uint16_t y, const uint8_t* chars, const CellAttr* attrs, size_t count) override
+	{
+		drawCellRun(static_cast<Backend&>(*this), x, y, Backend::getCharWidth(), chars, attrs, count);
+	}
+
+	void setBackColor(uint16_t col) override
+	{
+		Backend::setBackColor(col);
+	}
+
+	void setFrontColor(uint16_t col) override
+	{
+		Backend::setFrontColor(col);
+	}
+
+	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) override
+	{
+		Backend::fillRect(x, y, w, h, color);
+	}
+
+	void scroll(uint16_t top, uint16_t bottom, int16_t diff) override
+	{
+		Backend::scroll(top, bottom, diff);
+	}
+
+	uint16_t getWidth() override
+	{
+		return Backend::getWidth();
+	}
+
+	uint16_t getHeight() override
+	{
+		return Backend::getHeight();
+	}
+
+	uint8_t getCharWidth() override
+	{
+		return Backend::getCharWidth();
+	}
+
+	uint8_t getCharHeight() override
+	{
+		return Backend::getCharHeight();
+	}
+};
+
+} // namespace VT100
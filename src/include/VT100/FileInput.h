@@ -0,0 +1,39 @@
+/**
+ * FileInput.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Terminal.h"
+
+namespace VT100
+{
+/**
+ * @brief Feed a file through a terminal without copying it, e.g. to replay a console capture
+ * @param terminal
+ * @param filename
+ * @param windowSize How much of the file to map into memory at once
+ * @retval int64_t Number of bytes processed, or -1 if the file could not be opened or mapped
+ * @note The file is mapped a window at a time, so captures larger than the address space can be used
+ * and memory use stays bounded. Host builds only.
+ */
+int64_t feedFile(Terminal& terminal, const char* filename, size_t windowSize = 64 * 1024 * 1024);
+
+} // namespace VT100
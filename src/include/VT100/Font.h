@@ -0,0 +1,54 @@
+/**
+ * Font.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace VT100
+{
+/**
+ * @brief Monochrome bitmap font, up to 8 pixels wide
+ *
+ * Each glyph is `height` bytes, one per row, with the leftmost pixel in bit 0.
+ */
+struct Font {
+	uint8_t width;
+	uint8_t height;
+	uint8_t firstChar;
+	uint8_t charCount;
+	const uint8_t* data;
+	// Shown for characters not in the font
+	const uint8_t* missingGlyph;
+
+	const uint8_t* getGlyph(uint8_t ch) const
+	{
+		unsigned index = ch - firstChar;
+		return (index < charCount) ? &data[index * height] : missingGlyph;
+	}
+};
+
+/**
+ * @brief 8x8 font covering printable ASCII, from the public domain font8x8 by Daniel Hepper
+ */
+extern const Font font8x8;
+
+} // namespace VT100
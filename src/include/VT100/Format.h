@@ -0,0 +1,49 @@
+/**
+ * Format.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+
+namespace VT100
+{
+/**
+ * @brief Receives formatted output, a piece at a time
+ */
+using FormatWriter = void (*)(void* param, const char* data, size_t length);
+
+/**
+ * @brief printf-style formatting without an output buffer
+ * @param writer Called with each piece of output: literal text straight from `fmt`, string arguments,
+ * padding and converted numbers
+ * @param param Passed to writer
+ * @param fmt
+ * @param args
+ * @retval size_t Number of characters written
+ * @note Output is never truncated, and stack use doesn't depend on the length of the output.
+ * Supports the standard flags, width, precision and length modifiers. Floating-point conversions
+ * are passed to m_snprintf(), which may need a heap allocation for very large values with %f.
+ * %n is not supported: its argument is skipped.
+ */
+size_t formatStream(FormatWriter writer, void* param, const char* fmt, va_list args);
+
+} // namespace VT100
@@ -0,0 +1,168 @@
+/**
+ * FrameBufferDisplay.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Display.h"
+#include "Font.h"
+#include "GlyphCache.h"
+
+namespace VT100
+{
+/**
+ * @brief Display which renders into a framebuffer in memory
+ *
+ * Colours passed in are RGB565. With the RGB888 format pixels are stored as three bytes, red first.
+ */
+class FrameBufferDisplay : public Display
+{
+public:
+	enum class PixelFormat {
+		rgb565,
+		rgb888,
+	};
+
+	/**
+	 * @param buffer Caller-owned pixel memory, at least stride * height bytes
+	 * @param width, height Size in pixels
+	 * @param stride Bytes from one row to the next, 0 if rows are contiguous
+	 */
+	FrameBufferDisplay(void* buffer, uint16_t width, uint16_t height, PixelFormat format, size_t stride = 0,
+					   const Font& font = font8x8);
+
+	void drawString(uint16_t x, uint16_t y, const char* text) override;
+	void drawChar(uint16_t x, uint16_t y, uint8_t c) override;
+	void drawCells(uint16_t x, uint16_t y, const uint8_t* chars, const CellAttr* attrs, size_t count) override;
+
+	void setBackColor(uint16_t col) override
+	{
+		if(col != backColor) {
+			backColor = col;
+			expandValid = false;
+		}
+	}
+
+	void setFrontColor(uint16_t col) override
+	{
+		if(col != frontColor) {
+			frontColor = col;
+			expandValid = false;
+		}
+	}
+
+	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) override;
+	void scroll(uint16_t top, uint16_t bottom, int16_t diff) override;
+	bool copyRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t destX, uint16_t destY) override;
+
+	// Characters outside the font show as its missing glyph
+	uint8_t mapCodepoint(uint32_t codepoint) override
+	{
+		if(codepoint >= font.firstChar && codepoint < unsigned(font.firstChar + font.charCount)) {
+			return codepoint;
+		}
+		return font.firstChar + font.charCount;
+	}
+
+	uint16_t getWidth() override
+	{
+		return width;
+	}
+
+	uint16_t getHeight() override
+	{
+		return height;
+	}
+
+	uint8_t getCharWidth() override
+	{
+		return font.width;
+	}
+
+	uint8_t getCharHeight() override
+	{
+		return font.height;
+	}
+
+	PixelFormat getPixelFormat() const
+	{
+		return format;
+	}
+
+	uint8_t* getBuffer() const
+	{
+		return buffer;
+	}
+
+	size_t getStride() const
+	{
+		return stride;
+	}
+
+	/**
+	 * @brief Keep recently drawn glyphs ready-expanded, so drawing text is one block copy per cell
+	 * @param budget Bytes to use, 0 to disable
+	 * @retval bool false if the cache could not be allocated
+	 */
+	bool enableGlyphCache(size_t budget);
+
+	const GlyphCache& getGlyphCache() const
+	{
+		return glyphCache;
+	}
+
+	/**
+	 * @brief Read back a pixel as RGB565
+	 */
+	uint16_t getPixel(uint16_t x, uint16_t y) const;
+
+protected:
+	uint8_t* pixelAddress(uint16_t x, uint16_t y) const
+	{
+		return buffer + y * stride + x * bytesPerPixel;
+	}
+
+	// Write pixel data for a colour, in framebuffer format
+	void encode(uint8_t* dst, uint16_t color) const;
+	// Rebuild the nibble expansion table for the current colours
+	void updateExpand();
+	// Write glyph pixels in current colours
+	void expandGlyph(uint8_t* dst, size_t dstStride, const uint8_t* glyph);
+
+private:
+	uint8_t* buffer;
+	size_t stride;
+	uint16_t width;
+	uint16_t height;
+	PixelFormat format;
+	uint8_t bytesPerPixel;
+	const Font& font;
+	uint16_t frontColor{0xffff};
+	uint16_t backColor{0};
+	/*
+	 * Pixels for each combination of 4 glyph bits, so each nibble is written in one block
+	 * of 8 (RGB565) or 12 (RGB888) bytes. Aligned so copies work in whole words.
+	 */
+	uint32_t expand[16][3];
+	bool expandValid{false};
+	GlyphCache glyphCache;
+};
+
+} // namespace VT100
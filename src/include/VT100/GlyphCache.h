@@ -0,0 +1,143 @@
+/**
+ * GlyphCache.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace VT100
+{
+/**
+ * @brief Least-recently-used cache of rendered glyphs, for use by Display backends
+ *
+ * Each entry holds the pixels for one character drawn in one pair of colours, in whatever
+ * format the backend uses. Text then costs one block copy per cell instead of expanding
+ * the font bitmap every time.
+ */
+class GlyphCache
+{
+public:
+	~GlyphCache()
+	{
+		end();
+	}
+
+	/**
+	 * @brief Allocate the cache
+	 * @param budget Total bytes to use, including bookkeeping
+	 * @param glyphSize Bytes of pixel data per glyph
+	 * @retval bool false if budget is too small for one glyph, or allocation failed
+	 */
+	bool begin(size_t budget, size_t glyphSize);
+
+	void end();
+
+	// Discard all glyphs, e.g. if the font changes
+	void clear();
+
+	bool isEnabled() const
+	{
+		return entries != nullptr;
+	}
+
+	/**
+	 * @brief Get pixel data for a glyph, rendering it on a miss
+	 * @param render Called as render(uint8_t* pixels) to fill in a new entry
+	 * @retval const uint8_t* Pixel data, valid until the next call
+	 * @note The cache must be enabled
+	 */
+	template <typename Render> const uint8_t* get(uint8_t ch, uint16_t fore, uint16_t back, Render render)
+	{
+		auto pixels = find(ch, fore, back);
+		if(pixels == nullptr) {
+			pixels = insert(ch, fore, back);
+			render(pixels);
+		}
+		return pixels;
+	}
+
+	// Number of glyphs which fit in the cache
+	uint16_t getCapacity() const
+	{
+		return capacity;
+	}
+
+	uint32_t getHits() const
+	{
+		return hits;
+	}
+
+	uint32_t getMisses() const
+	{
+		return misses;
+	}
+
+	void resetCounters()
+	{
+		hits = misses = 0;
+	}
+
+protected:
+	// Returns nullptr if not cached
+	uint8_t* find(uint8_t ch, uint16_t fore, uint16_t back);
+	// Evict the least recently used glyph and return its storage for the new one
+	uint8_t* insert(uint8_t ch, uint16_t fore, uint16_t back);
+
+private:
+	static constexpr uint16_t none = 0xffff;
+
+	struct Entry {
+		uint16_t fore;
+		uint16_t back;
+		uint8_t ch;
+		bool used;
+		// Next entry in the same hash bucket
+		uint16_t chain;
+		// Recently used list, most recent first
+		uint16_t prev;
+		uint16_t next;
+	};
+
+	unsigned getBucket(uint8_t ch, uint16_t fore, uint16_t back) const
+	{
+		uint32_t hash = ((uint32_t(fore) << 16) | back) * 0x9E3779B1U;
+		hash ^= ch * 0x85EBCA6BU;
+		return (hash ^ (hash >> 16)) & (bucketCount - 1);
+	}
+
+	void unlink(uint16_t index);
+	void pushFront(uint16_t index);
+	void removeFromBucket(uint16_t index);
+
+	Entry* entries{nullptr};
+	uint16_t* buckets{nullptr};
+	uint8_t* pixels{nullptr};
+	size_t glyphSize{0};
+	uint16_t capacity{0};
+	uint16_t bucketCount{0};
+	uint16_t head{none};
+	uint16_t tail{none};
+	uint32_t hits{0};
+	uint32_t misses{0};
+};
+
+} // namespace VT100
@@ -0,0 +1,239 @@
+/**
+ * InputRing.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace VT100
+{
+/**
+ * @brief Lock-free byte queue between one producer, such as a UART interrupt or DMA completion
+ * handler, and one consumer, normally Terminal::pump()
+ *
+ * The producer only writes `head` and its own counters, the consumer only writes `tail` and its own,
+ * so neither side ever needs to disable interrupts. Data which doesn't fit is dropped and counted.
+ *
+ * Watermarks are for flow control: when the level reaches the high watermark the callback is
+ * invoked with `true`, from the producer's context, and when the consumer has drained it
+ * to the low watermark it is invoked with `false`, from the consumer's context.
+ *
+ * @note push() is inline so it may be called from an interrupt handler in IRAM.
+ * A watermark callback must then also be in IRAM.
+ */
+class InputRing
+{
+public:
+	using WatermarkCallback = void (*)(void* param, bool high);
+
+	~InputRing()
+	{
+		end();
+	}
+
+	/**
+	 * @brief Allocate buffer
+	 * @param capacity Size in bytes, rounded up to a power of 2
+	 * @note Watermarks default to 3/4 and 1/4 of capacity, with no callback
+	 */
+	bool begin(size_t capacity);
+
+	/**
+	 * @brief Use a caller-owned buffer
+	 * @param buffer
+	 * @param capacity Size of buffer, a power of 2 and at least 16
+	 */
+	bool begin(uint8_t* buffer, size_t capacity);
+
+	void end();
+
+	bool isEnabled() const
+	{
+		return buffer != nullptr;
+	}
+
+	size_t getCapacity() const
+	{
+		return mask + 1;
+	}
+
+	/**
+	 * @brief Set flow control thresholds
+	 * @param high Level at which to call `callback(param, true)`
+	 * @param low Level at which to call `callback(param, false)`, once the high watermark has been reached
+	 * @note Call before the producer is started
+	 */
+	void setWatermarks(size_t high, size_t low, WatermarkCallback callback = nullptr, void* param = nullptr);
+
+	/*
+	 * Producer
+	 */
+
+	/**
+	 * @brief Add data, dropping whatever doesn't fit
+	 * @retval size_t Number of bytes accepted
+	 */
+	__attribute__((always_inline)) size_t push(const void* data, size_t length)
+	{
+		if(buffer == nullptr) {
+			return 0;
+		}
+		uint32_t h = head.load(std::memory_order_relaxed);
+		uint32_t level = h - tail.load(std::memory_order_acquire);
+		size_t space = getCapacity() - level;
+		size_t n = (length < space) ? length : space;
+		if(n != 0) {
+			size_t offset = h & mask;
+			size_t first = (n < getCapacity() - offset) ? n : getCapacity() - offset;
+			memcpy(&buffer[offset], data, first);
+			memcpy(buffer, static_cast<const uint8_t*>(data) + first, n - first);
+			head.store(h + n, std::memory_order_release);
+		}
+		pushed(level + n, length - n);
+		return n;
+	}
+
+	__attribute__((always_inline)) bool push(uint8_t c)
+	{
+		if(buffer == nullptr) {
+			return false;
+		}
+		uint32_t h = head.load(std::memory_order_relaxed);
+		uint32_t level = h - tail.load(std::memory_order_acquire);
+		if(level > mask) {
+			pushed(level, 1);
+			return false;
+		}
+		buffer[h & mask] = c;
+		head.store(h + 1, std::memory_order_release);
+		pushed(level + 1, 0);
+		return true;
+	}
+
+	/*
+	 * Consumer
+	 */
+
+	/**
+	 * @brief Get the oldest contiguous block of queued data
+	 * @param data On return, points to the data
+	 * @retval size_t Number of bytes, 0 if the ring is empty
+	 * @note The data stays valid until consume() is called
+	 */
+	size_t peek(const uint8_t*& data) const
+	{
+		if(buffer == nullptr) {
+			return 0;
+		}
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		size_t level = head.load(std::memory_order_acquire) - t;
+		size_t offset = t & mask;
+		data = &buffer[offset];
+		return (level < getCapacity() - offset) ? level : getCapacity() - offset;
+	}
+
+	/**
+	 * @brief Release data obtained from peek()
+	 */
+	void consume(size_t length);
+
+	/*
+	 * Either side
+	 */
+
+	size_t getLevel() const
+	{
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Determine if the high watermark has been reached and the level not yet fallen to the low watermark
+	 */
+	bool isThrottled() const
+	{
+		return highCount.load(std::memory_order_acquire) != lowCount.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Get number of bytes dropped because the ring was full
+	 */
+	uint32_t getOverflowCount() const
+	{
+		return overflowCount.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Get the highest level seen since begin() or resetPeakLevel()
+	 */
+	size_t getPeakLevel() const
+	{
+		return peakLevel.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Reset overflow count and peak level
+	 * @note Only safe while the producer is stopped
+	 */
+	void resetCounters()
+	{
+		overflowCount.store(0, std::memory_order_relaxed);
+		peakLevel.store(getLevel(), std::memory_order_relaxed);
+	}
+
+private:
+	// Update producer counters. Only plain loads and stores are used, as some targets have no atomic read-modify-write.
+	__attribute__((always_inline)) void pushed(uint32_t level, size_t dropped)
+	{
+		if(dropped != 0) {
+			overflowCount.store(overflowCount.load(std::memory_order_relaxed) + dropped, std::memory_order_relaxed);
+		}
+		if(level > peakLevel.load(std::memory_order_relaxed)) {
+			peakLevel.store(level, std::memory_order_relaxed);
+		}
+		if(level >= highWatermark && !isThrottled()) {
+			highCount.store(highCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			if(callback != nullptr) {
+				callback(param, true);
+			}
+		}
+	}
+
+	uint8_t* buffer{nullptr};
+	bool ownBuffer{false};
+	uint32_t mask{0};
+	uint32_t highWatermark{0};
+	uint32_t lowWatermark{0};
+	WatermarkCallback callback{nullptr};
+	void* param{nullptr};
+	// Free-running positions, masked to index the buffer
+	std::atomic<uint32_t> head{0};
+	std::atomic<uint32_t> tail{0};
+	// Number of times each watermark has been passed: throttled while they differ
+	std::atomic<uint32_t> highCount{0};
+	std::atomic<uint32_t> lowCount{0};
+	std::atomic<uint32_t> overflowCount{0};
+	std::atomic<uint32_t> peakLevel{0};
+};
+
+} // namespace VT100
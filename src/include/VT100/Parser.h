@@ -0,0 +1,131 @@
+/**
+ * Parser.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+
+	Escape sequence parser based on the DEC VT500-series state diagram
+	described by Paul Flo Williams at https://vt100.net/emu/dec_ansi_parser
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace VT100
+{
+#define VT100_STATE_MAP(XX)                                                                                            \
+	XX(ground)                                                                                                         \
+	XX(escape)                                                                                                         \
+	XX(escape_intermediate)                                                                                            \
+	XX(csi_entry)                                                                                                      \
+	XX(csi_param)                                                                                                      \
+	XX(csi_intermediate)                                                                                               \
+	XX(csi_ignore)                                                                                                     \
+	XX(dcs_entry)                                                                                                      \
+	XX(dcs_param)                                                                                                      \
+	XX(dcs_intermediate)                                                                                               \
+	XX(dcs_passthrough)                                                                                                \
+	XX(dcs_ignore)                                                                                                     \
+	XX(osc_string)                                                                                                     \
+	XX(sos_pm_apc_string)
+
+#define VT100_ACTION_MAP(XX)                                                                                           \
+	XX(none)                                                                                                           \
+	XX(print)                                                                                                          \
+	XX(execute)                                                                                                        \
+	XX(clear)                                                                                                          \
+	XX(collect)                                                                                                        \
+	XX(param)                                                                                                          \
+	XX(esc_dispatch)                                                                                                   \
+	XX(csi_dispatch)                                                                                                   \
+	XX(hook)                                                                                                           \
+	XX(put)                                                                                                            \
+	XX(unhook)                                                                                                         \
+	XX(osc_start)                                                                                                      \
+	XX(osc_put)                                                                                                        \
+	XX(osc_end)
+
+enum class State : uint8_t {
+#define XX(s) s,
+	VT100_STATE_MAP(XX)
+#undef XX
+};
+
+enum class Action : uint8_t {
+#define XX(a) a,
+	VT100_ACTION_MAP(XX)
+#undef XX
+};
+
+namespace Parser
+{
+/*
+ * Bytes are reduced to one of these classes before looking up the transition table
+ */
+enum ByteClass : uint8_t {
+	BC_C0, // 0x00-0x17, 0x19, 0x1c-0x1f except BEL
+	BC_BEL, // 0x07, also terminates OSC strings
+	BC_CANCEL, // 0x18 CAN, 0x1a SUB
+	BC_ESC, // 0x1b
+	BC_INTER, // 0x20-0x2f intermediate
+	BC_DIGIT, // 0x30-0x39
+	BC_COLON, // 0x3a
+	BC_SEMI, // 0x3b
+	BC_PRIVATE, // 0x3c-0x3f private marker
+	BC_FINAL, // 0x40-0x7e not listed below
+	BC_DCS, // 'P'
+	BC_SOS, // 'X', '^', '_'
+	BC_CSI, // '['
+	BC_OSC, // ']'
+	BC_DEL, // 0x7f
+	BC_HIGH, // 0x80-0xff, printed as-is
+	BC_COUNT,
+};
+
+const unsigned stateCount = 0
+#define XX(s) +1
+	VT100_STATE_MAP(XX)
+#undef XX
+	;
+
+/*
+ * Transition table entries pack the action in the upper nibble and next state in the lower nibble.
+ * A state value of `stateUnchanged` means no transition, so no exit/entry actions.
+ */
+const uint8_t stateUnchanged = 0x0f;
+
+static_assert(stateCount < stateUnchanged, "Too many states");
+
+inline Action getAction(uint8_t entry)
+{
+	return Action(entry >> 4);
+}
+
+inline uint8_t getNextState(uint8_t entry)
+{
+	return entry & 0x0f;
+}
+
+extern const uint8_t byteClasses[256];
+extern const uint8_t transitions[stateCount][BC_COUNT];
+extern const Action entryActions[stateCount];
+extern const Action exitActions[stateCount];
+
+} // namespace Parser
+
+} // namespace VT100
@@ -0,0 +1,237 @@
+/**
+ * Recording.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Terminal.h"
+#include <cstdlib>
+
+namespace VT100
+{
+/*
+ * A recording is a sequence of records, each with a 9-byte header:
+ *
+ * 	type (1) | timestamp (4) | payload length (4) | payload
+ *
+ * Timestamps are milliseconds from the start of the recording. Record types:
+ *
+ * 	'H' Header, first record only: magic (4) | columns (2) | rows (2)
+ * 	'D' Data passed to Terminal::nputs()
+ * 	'K' Keyframe: snapshot from Terminal::saveState()
+ * 	'I' Index of all keyframes: count (4) | { timestamp (4) | record offset (8) }...
+ * 	'E' End: magic (4) | index record offset (8), always the last record of a closed recording
+ *
+ * All values are little-endian. Records are only ever appended, so a recording can be streamed,
+ * and one which wasn't closed can still be played by scanning it for keyframes.
+ * Appending a session adds records after the 'E' record, then a new index and end record.
+ */
+
+/**
+ * @brief Where a Recorder writes to
+ */
+class RecordingOutput
+{
+public:
+	virtual ~RecordingOutput()
+	{
+	}
+
+	virtual bool write(const void* data, size_t length) = 0;
+};
+
+/**
+ * @brief Where a Player reads from
+ */
+class RecordingInput
+{
+public:
+	virtual ~RecordingInput()
+	{
+	}
+
+	virtual bool read(uint64_t offset, void* buffer, size_t length) = 0;
+	virtual uint64_t getSize() = 0;
+};
+
+class Player;
+
+/**
+ * @brief Record input to a terminal, with keyframes for seeking
+ */
+class Recorder
+{
+public:
+	struct Keyframe {
+		uint32_t timestamp;
+		uint64_t offset;
+	};
+
+	Recorder(Terminal& terminal) : terminal(terminal)
+	{
+	}
+
+	~Recorder()
+	{
+		free(keyframes);
+	}
+
+	/**
+	 * @brief Start recording
+	 * @param output
+	 * @param existing To append to a recording, a Player opened on it. The output must be
+	 * positioned at existing->getEndOffset(), and timestamps continue from existing->getDuration().
+	 * @param timestamp
+	 * @retval bool false if the terminal has no cell grid, sizes differ, or output failed
+	 * @note A keyframe is written straight away, so playback can start from here
+	 */
+	bool begin(RecordingOutput& output, uint32_t timestamp = 0, const Player* existing = nullptr);
+
+	/**
+	 * @brief Pass data to the terminal, and record it
+	 */
+	size_t write(const char* data, size_t length, uint32_t timestamp);
+
+	/**
+	 * @brief Write a keyframe now, rather than waiting for the interval
+	 */
+	bool keyframe(uint32_t timestamp);
+
+	/**
+	 * @brief Finish recording, writing the keyframe index
+	 */
+	bool end(uint32_t timestamp);
+
+	/**
+	 * @brief Set how much data is recorded between keyframes
+	 * @note More frequent keyframes make seeking faster at the cost of a larger recording
+	 */
+	void setKeyframeInterval(size_t bytes)
+	{
+		keyframeInterval = bytes;
+	}
+
+	static constexpr size_t defaultKeyframeInterval = 64 * 1024;
+
+private:
+	bool writeRecord(char type, uint32_t timestamp, const void* data, size_t length);
+	bool addKeyframe(uint32_t timestamp, uint64_t offset);
+
+	Terminal& terminal;
+	RecordingOutput* output{nullptr};
+	uint64_t offset{0};
+	Keyframe* keyframes{nullptr};
+	unsigned keyframeCount{0};
+	unsigned keyframeCapacity{0};
+	size_t keyframeInterval{defaultKeyframeInterval};
+	size_t bytesSinceKeyframe{0};
+};
+
+/**
+ * @brief Play back a recording, seeking by restoring the nearest keyframe and replaying from there
+ */
+class Player
+{
+public:
+	using Keyframe = Recorder::Keyframe;
+
+	~Player()
+	{
+		end();
+	}
+
+	/**
+	 * @brief Open a recording and load its keyframe index
+	 * @note A recording which wasn't closed has no index, so is scanned instead
+	 */
+	bool begin(RecordingInput& input);
+
+	void end();
+
+	/**
+	 * @brief Show the screen as it was at a given time
+	 * @param terminal Must have the cell grid enabled and the same size as the recording
+	 * @param timestamp
+	 * @retval bool false on read error or if the terminal doesn't match
+	 * @note Finding the keyframe takes O(log n), then at most one keyframe interval of data is replayed
+	 */
+	bool seek(Terminal& terminal, uint32_t timestamp);
+
+	/**
+	 * @brief Carry on playing from the current position
+	 * @retval bool false on read error
+	 */
+	bool play(Terminal& terminal, uint32_t timestamp);
+
+	uint16_t getColumnCount() const
+	{
+		return cols;
+	}
+
+	uint16_t getRowCount() const
+	{
+		return rows;
+	}
+
+	uint32_t getDuration() const
+	{
+		return duration;
+	}
+
+	unsigned getKeyframeCount() const
+	{
+		return keyframeCount;
+	}
+
+	const Keyframe* getKeyframes() const
+	{
+		return keyframes;
+	}
+
+	/**
+	 * @brief Get offset following the last complete record, where any appended session starts
+	 */
+	uint64_t getEndOffset() const
+	{
+		return endOffset;
+	}
+
+private:
+	struct RecordHeader {
+		char type;
+		uint32_t timestamp;
+		uint32_t length;
+	};
+
+	bool readHeader(uint64_t offset, RecordHeader& header);
+	bool loadIndex();
+	bool scan();
+
+	RecordingInput* input{nullptr};
+	Keyframe* keyframes{nullptr};
+	unsigned keyframeCount{0};
+	uint64_t endOffset{0};
+	uint64_t position{0};
+	uint32_t duration{0};
+	uint16_t cols{0};
+	uint16_t rows{0};
+};
+
+} // namespace VT100
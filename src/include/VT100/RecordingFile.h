@@ -0,0 +1,84 @@
+/**
+ * RecordingFile.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Recording.h"
+#include <cstdio>
+
+namespace VT100
+{
+/**
+ * @brief Write a recording to a file
+ * @note Host builds only
+ */
+class RecordingFileWriter : public RecordingOutput
+{
+public:
+	~RecordingFileWriter()
+	{
+		close();
+	}
+
+	/**
+	 * @param filename
+	 * @param offset 0 to create a new recording, or Player::getEndOffset() to append to an existing one,
+	 * discarding anything after that point
+	 */
+	bool open(const char* filename, uint64_t offset = 0);
+
+	void close();
+
+	bool write(const void* data, size_t length) override;
+
+private:
+	FILE* file{nullptr};
+};
+
+/**
+ * @brief Read a recording from a file
+ * @note Host builds only
+ */
+class RecordingFileReader : public RecordingInput
+{
+public:
+	~RecordingFileReader()
+	{
+		close();
+	}
+
+	bool open(const char* filename);
+
+	void close();
+
+	bool read(uint64_t offset, void* buffer, size_t length) override;
+
+	uint64_t getSize() override
+	{
+		return size;
+	}
+
+private:
+	FILE* file{nullptr};
+	uint64_t size{0};
+};
+
+} // namespace VT100
@@ -0,0 +1,50 @@
+/**
+ * Scanner.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <cstddef>
+
+namespace VT100
+{
+/**
+ * @brief Get length of leading plain text, i.e. bytes in the range 0x20-0x7e
+ * @param str
+ * @param length
+ * @retval size_t Offset of the first control, DEL or non-ASCII byte, or `length` if there are none
+ * @note Uses SSE2/AVX2 or NEON where available, otherwise processes a word at a time
+ */
+size_t scanText(const char* str, size_t length);
+
+/**
+ * @brief Name of the implementation used by scanText(), for diagnostics
+ */
+extern const char* const scanTextMethod;
+
+/**
+ * @brief Portable implementations, also used by scanText() for short or trailing data
+ * @{
+ */
+size_t scanTextScalar(const char* str, size_t length);
+size_t scanTextSwar(const char* str, size_t length);
+/** @} */
+
+} // namespace VT100
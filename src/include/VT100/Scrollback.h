@@ -0,0 +1,163 @@
+/**
+ * Scrollback.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "CellGrid.h"
+#include "Style.h"
+#include "Unicode.h"
+
+namespace VT100
+{
+/**
+ * @brief Ring buffer of lines which have scrolled off the top of the screen
+ *
+ * Each line is stored as a record:
+ *
+ * 	size (2 bytes) | runs... | size (2 bytes)
+ *
+ * The trailing copy of the size allows walking back from the newest line.
+ * Each run is a header byte giving the character count (1-127), with bit 7 set if
+ * a 5-byte style follows, then the characters. Lines start with the default style
+ * and trailing blanks are not stored.
+ *
+ * Records never straddle the end of the buffer, so a decoded line always refers to contiguous memory.
+ */
+class Scrollback
+{
+public:
+	/**
+	 * @brief Allocator for the ring buffer, e.g. to put it in PSRAM
+	 */
+	struct Allocator {
+		void* (*allocate)(size_t size);
+		void (*release)(void* ptr);
+	};
+
+	/**
+	 * @brief A decoded line
+	 */
+	struct Line {
+		const uint8_t* data;
+		uint16_t size;
+
+		/**
+		 * @brief Iterate through runs of characters sharing a style
+		 * @param callback Called as `callback(col, chars, count, style)` for each run
+		 * @retval unsigned Number of characters in the line
+		 */
+		template <typename Callback> unsigned forEachRun(Callback callback) const
+		{
+			Style style = defaultStyle;
+			unsigned col = 0;
+			for(unsigned pos = 0; pos < size;) {
+				uint8_t header = data[pos++];
+				if(header & 0x80) {
+					style = readStyle(&data[pos]);
+					pos += styleSize;
+				}
+				unsigned count = header & 0x7f;
+				callback(col, reinterpret_cast<const char*>(&data[pos]), count, style);
+				pos += count;
+				col += count;
+			}
+			return col;
+		}
+	};
+
+	~Scrollback()
+	{
+		end();
+	}
+
+	/**
+	 * @brief Allocate buffer
+	 * @param capacity Size of buffer in bytes
+	 * @param allocator Optional, uses malloc/free by default
+	 */
+	bool begin(size_t capacity, const Allocator* allocator = nullptr);
+
+	void end();
+
+	void clear();
+
+	bool isEnabled() const
+	{
+		return buffer != nullptr;
+	}
+
+	/**
+	 * @brief Add a line, discarding the oldest lines to make room if necessary
+	 * @note Characters are stored as the font glyphs drawn for them
+	 */
+	void push(const Cell* cells, uint16_t count, const StyleTable& styles, const CharTable& chars);
+
+	unsigned getLineCount() const
+	{
+		return lineCount;
+	}
+
+	/**
+	 * @brief Get a line
+	 * @param index 0 for the most recent line
+	 * @param line
+	 * @retval bool false if index is out of range
+	 */
+	bool getLine(unsigned index, Line& line) const;
+
+	static constexpr unsigned styleSize = 5;
+
+private:
+	static Style readStyle(const uint8_t* p)
+	{
+		return Style{uint16_t(p[0] | (p[1] << 8)), uint16_t(p[2] | (p[3] << 8)), p[4]};
+	}
+
+	static uint8_t* writeStyle(uint8_t* p, const Style& style);
+
+	uint16_t readSize(size_t pos) const
+	{
+		return buffer[pos] | (buffer[pos + 1] << 8);
+	}
+
+	void writeSize(size_t pos, uint16_t size)
+	{
+		buffer[pos] = size;
+		buffer[pos + 1] = size >> 8;
+	}
+
+	size_t reserve(size_t size);
+	void discardOldest();
+
+	uint8_t* buffer{nullptr};
+	size_t capacity{0};
+	const Allocator* allocator{nullptr};
+	// Offset of oldest record
+	size_t tail{0};
+	// Offset for next record
+	size_t head{0};
+	// When wrapped, records continue from start of buffer and data ends at wrapEnd
+	size_t wrapEnd{0};
+	bool wrapped{false};
+	unsigned lineCount{0};
+};
+
+} // namespace VT100
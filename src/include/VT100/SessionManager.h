@@ -0,0 +1,164 @@
+/**
+ * SessionManager.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Terminal.h"
+#include "CellDisplay.h"
+#include "ThreadPool.h"
+#include "TripleBuffer.h"
+
+namespace VT100
+{
+/**
+ * @brief Screen content of a session after a batch of input
+ */
+struct Snapshot {
+	uint16_t cols{0};
+	uint16_t rows{0};
+	// Characters and colours, row by row
+	std::vector<uint8_t> chars;
+	std::vector<CellAttr> attrs;
+	// Total input processed up to this snapshot
+	uint64_t bytesProcessed{0};
+};
+
+class SessionManager;
+
+/**
+ * @brief A headless terminal owned by a SessionManager
+ */
+class Session
+{
+public:
+	/**
+	 * @brief Get the most recent screen content
+	 * @retval const Snapshot* nullptr until some input has been processed
+	 * @note Call from one thread only. The snapshot remains valid until the next call.
+	 */
+	const Snapshot* getSnapshot()
+	{
+		return snapshots.read();
+	}
+
+	uint64_t getBytesProcessed() const
+	{
+		return bytesProcessed.load(std::memory_order_relaxed);
+	}
+
+private:
+	friend class SessionManager;
+
+	class NullCallbacks : public Callbacks
+	{
+	public:
+		void sendResponse(const char*) override
+		{
+		}
+	};
+
+	Session(uint16_t cols, uint16_t rows) : display(cols, rows), terminal(display, callbacks)
+	{
+	}
+
+	void publish();
+
+	CellDisplay display;
+	NullCallbacks callbacks;
+	Terminal terminal;
+	// Input waiting to be processed, appended by writers
+	std::mutex inputMutex;
+	std::vector<char> input;
+	// Input being processed, only touched by the worker running the session
+	std::vector<char> batch;
+	// Set while the session is queued or running, so only one worker ever has it
+	std::atomic<bool> scheduled{false};
+	std::atomic<uint64_t> bytesProcessed{0};
+	TripleBuffer<Snapshot> snapshots;
+};
+
+/**
+ * @brief Runs many headless terminals, parsing their input on a pool of worker threads
+ *
+ * Input for each session is processed in the order written, by one worker at a time.
+ * Different sessions are processed in parallel. After each batch of input the session
+ * publishes a Snapshot, which readers pick up without locking.
+ *
+ * @note Host builds only
+ */
+class SessionManager
+{
+public:
+	/**
+	 * @param threadCount 0 for one per hardware thread
+	 */
+	explicit SessionManager(unsigned threadCount = 0) : pool(threadCount)
+	{
+	}
+
+	~SessionManager()
+	{
+		waitIdle();
+	}
+
+	/**
+	 * @brief Create a new session
+	 * @retval Session* nullptr if the screen could not be allocated. Owned by the manager.
+	 */
+	Session* createSession(uint16_t cols, uint16_t rows);
+
+	/**
+	 * @brief Queue input for a session, which is copied
+	 */
+	void write(Session& session, const char* data, size_t length);
+
+	/**
+	 * @brief Wait until all queued input has been processed
+	 */
+	void waitIdle();
+
+	unsigned getThreadCount() const
+	{
+		return pool.getThreadCount();
+	}
+
+	size_t getSessionCount()
+	{
+		std::lock_guard<std::mutex> lock(sessionMutex);
+		return sessions.size();
+	}
+
+private:
+	void schedule(Session& session);
+	void process(Session& session);
+	void finished();
+
+	std::mutex sessionMutex;
+	std::vector<std::unique_ptr<Session>> sessions;
+	// Number of sessions queued or running
+	std::atomic<unsigned> busy{0};
+	std::mutex idleMutex;
+	std::condition_variable idle;
+	// Declared last so workers stop before anything they use is destroyed
+	ThreadPool pool;
+};
+
+} // namespace VT100
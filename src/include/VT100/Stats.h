@@ -0,0 +1,106 @@
+/**
+ * Scrollback.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Parser.h"
+
+#ifndef VT100_ENABLE_STATS
+#define VT100_ENABLE_STATS 0
+#endif
+
+/*
+ * Statement which is only compiled in when statistics are enabled
+ */
+#if VT100_ENABLE_STATS
+#define VT100_STATS(stmt) stmt
+#else
+#define VT100_STATS(stmt)
+#endif
+
+namespace VT100
+{
+/**
+ * @brief Counters showing which parts of the terminal a stream of output exercises
+ * @note Only available when built with VT100_ENABLE_STATS=1
+ */
+struct Stats {
+	// Final bytes range from '0' for ESC sequences and '@' for CSI sequences, up to '~'
+	static constexpr uint8_t escFirst = 0x30;
+	static constexpr uint8_t csiFirst = 0x40;
+	static constexpr uint8_t finalLast = 0x7e;
+
+	struct DisplayCalls {
+		uint32_t drawString;
+		uint32_t drawChar;
+		uint32_t drawCells;
+		uint32_t setColor;
+		uint32_t fillRect;
+		uint32_t scroll;
+		uint32_t copyRect;
+	};
+
+	// Bytes processed in each parser state, including plain text in ground state
+	uint32_t stateBytes[Parser::stateCount];
+	// Sequences dispatched, indexed by final byte
+	uint32_t escSequences[finalLast + 1 - escFirst];
+	uint32_t csiSequences[finalLast + 1 - csiFirst];
+	// Sequences dispatched which the terminal does not act upon
+	uint32_t unknownSequences;
+	// Malformed CSI sequences, DCS, OSC, SOS, PM and APC strings, which are all discarded
+	uint32_t ignoredSequences;
+	DisplayCalls displayCalls;
+	// Pixels written by fillRect()
+	uint64_t pixelsFilled;
+	uint32_t scrolls;
+	uint32_t linesCleared;
+
+	uint32_t getStateBytes(State state) const
+	{
+		return stateBytes[unsigned(state)];
+	}
+
+	uint32_t getEscCount(char final) const
+	{
+		return (final >= escFirst && final <= finalLast) ? escSequences[final - escFirst] : 0;
+	}
+
+	uint32_t getCsiCount(char final) const
+	{
+		return (final >= csiFirst && final <= finalLast) ? csiSequences[final - csiFirst] : 0;
+	}
+
+	void countEsc(uint8_t final)
+	{
+		if(final >= escFirst && final <= finalLast) {
+			++escSequences[final - escFirst];
+		}
+	}
+
+	void countCsi(uint8_t final)
+	{
+		if(final >= csiFirst && final <= finalLast) {
+			++csiSequences[final - csiFirst];
+		}
+	}
+};
+
+} // namespace VT100
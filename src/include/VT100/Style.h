@@ -0,0 +1,170 @@
+/**
+ * Style.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include "Display.h"
+
+#ifndef VT100_MAX_STYLES
+#define VT100_MAX_STYLES 32
+#endif
+
+namespace VT100
+{
+/**
+ * @brief Character attributes as set by SGR (CSI ... m) sequences
+ *
+ * Colours are palette indices (0-255) unless the corresponding RGB flag is set,
+ * in which case they hold an RGB565 value.
+ */
+struct Style {
+	enum Flag {
+		bold = 0x01,
+		dim = 0x02,
+		underline = 0x04,
+		blink = 0x08,
+		reverse = 0x10,
+		conceal = 0x20,
+		foreRgb = 0x40,
+		backRgb = 0x80,
+	};
+
+	enum Color {
+		black = 0,
+		white = 7,
+	};
+
+	uint16_t fore;
+	uint16_t back;
+	uint8_t flags;
+
+	bool operator==(const Style& other) const
+	{
+		return fore == other.fore && back == other.back && flags == other.flags;
+	}
+
+	bool operator!=(const Style& other) const
+	{
+		return !operator==(other);
+	}
+
+	void setFore(uint16_t color, bool rgb)
+	{
+		fore = color;
+		flags = rgb ? (flags | foreRgb) : (flags & ~foreRgb);
+	}
+
+	void setBack(uint16_t color, bool rgb)
+	{
+		back = color;
+		flags = rgb ? (flags | backRgb) : (flags & ~backRgb);
+	}
+
+	/**
+	 * @brief Get the colours to draw with, applying bold, dim, reverse and conceal
+	 */
+	CellAttr resolve() const;
+
+	/**
+	 * @brief Get the style for erasing cells, which only keeps the background colour
+	 */
+	Style getEraseStyle() const;
+
+	/**
+	 * @brief Apply an SGR parameter list
+	 * @param params
+	 * @param count
+	 */
+	void applySgr(const uint16_t* params, unsigned count);
+};
+
+const Style defaultStyle{Style::white, Style::black, 0};
+
+/**
+ * @brief Get RGB565 value for a palette index
+ *
+ * 0-15 are the ANSI colours, 16-231 a 6x6x6 colour cube and 232-255 a grey ramp, as for xterm.
+ */
+uint16_t getPaletteColor(uint8_t index);
+
+inline uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+}
+
+/**
+ * @brief Interned set of styles, so character cells need only store a one-byte ID
+ *
+ * ID 0 is always the default style.
+ */
+class StyleTable
+{
+public:
+	static constexpr unsigned maxStyles = VT100_MAX_STYLES;
+	static constexpr uint8_t invalid = 0xff;
+
+	static_assert(maxStyles >= 2 && maxStyles < 256, "VT100_MAX_STYLES out of range");
+
+	StyleTable()
+	{
+		reset();
+	}
+
+	// Remove everything except the default style
+	void reset();
+
+	/**
+	 * @brief Find or add a style
+	 * @retval uint8_t ID, or `invalid` if the table is full
+	 */
+	uint8_t intern(const Style& style);
+
+	const Style& operator[](uint8_t id) const
+	{
+		return styles[id];
+	}
+
+	/**
+	 * @brief Release all styles not marked as used
+	 * @param used Bitmap with one bit per ID
+	 */
+	void collect(const uint32_t* used);
+
+	unsigned count() const;
+
+	static constexpr unsigned bitmapWords = (maxStyles + 31) / 32;
+
+	static void mark(uint32_t* bitmap, uint8_t id)
+	{
+		bitmap[id / 32] |= 1U << (id % 32);
+	}
+
+	static bool isMarked(const uint32_t* bitmap, uint8_t id)
+	{
+		return bitmap[id / 32] & (1U << (id % 32));
+	}
+
+private:
+	Style styles[maxStyles];
+	uint32_t allocated[bitmapWords];
+};
+
+} // namespace VT100
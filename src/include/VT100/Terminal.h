@@ -26,30 +26,32 @@
 #pragma once
 
 #include "Display.h"
+#include "CellGrid.h"
+#include "Style.h"
+#include "Scrollback.h"
+#include "Parser.h"
+#include "Stats.h"
+#include "Unicode.h"
+#include "InputRing.h"
+#include <cstdarg>
+#include <algorithm>
 
 namespace VT100
 {
-// events that are passed into states
-enum {
-	EV_CHAR = 1,
-};
-
-#define VT100_STATE_MAP(XX)                                                                                            \
-	XX(idle)                                                                                                           \
-	XX(command_arg)                                                                                                    \
-	XX(esc_sq_bracket)                                                                                                 \
-	XX(esc_question)                                                                                                   \
-	XX(esc_hash)                                                                                                       \
-	XX(esc_left_br)                                                                                                    \
-	XX(esc_right_br)                                                                                                   \
-	XX(escape)
-
 class Callbacks
 {
 public:
 	virtual void sendResponse(const char* str) = 0;
 };
 
+/**
+ * @brief A block of input, for passing several blocks to Terminal::nputs() at once
+ */
+struct InputSpan {
+	const char* data;
+	size_t length;
+};
+
 class Terminal
 {
 public:
@@ -61,7 +63,153 @@ public:
 	void putc(uint8_t ch, unsigned count = 1);
 	void puts(const char* str);
 	size_t nputs(const char* str, size_t length);
+
+	/**
+	 * @brief Process several blocks of input in order, as if concatenated
+	 * @retval size_t Total number of bytes
+	 * @note Sequences may be split across blocks. The display is flushed once, at the end.
+	 */
+	size_t nputs(const InputSpan* spans, size_t count);
+
+	/**
+	 * @brief Same as nputs(), for use as a byte sink
+	 */
+	size_t write(const uint8_t* data, size_t length)
+	{
+		return nputs(reinterpret_cast<const char*>(data), length);
+	}
+
+	/**
+	 * @brief Formatted output
+	 * @retval size_t Number of characters output
+	 * @note Output goes to the parser as it is formatted, so has no length limit. See formatStream().
+	 */
 	size_t printf(const char* fmt, ...);
+	size_t vprintf(const char* fmt, va_list args);
+
+	/**
+	 * @brief Queue input in a ring buffer, to be processed by pump()
+	 * @param capacity Size in bytes, 0 to disable
+	 * @retval bool false if the buffer could not be allocated
+	 * @note Use getInput().push() to add data, e.g. from an interrupt handler
+	 */
+	bool enableInputRing(size_t capacity);
+
+	/**
+	 * @brief Queue input in a caller-owned ring buffer
+	 * @param buffer
+	 * @param capacity Size of buffer, a power of 2 and at least 16
+	 */
+	bool enableInputRing(uint8_t* buffer, size_t capacity)
+	{
+		return input.begin(buffer, capacity);
+	}
+
+	InputRing& getInput()
+	{
+		return input;
+	}
+
+	/**
+	 * @brief Process input queued in the ring buffer
+	 * @param maxBytes Limit on how much to process
+	 * @retval size_t Number of bytes processed
+	 */
+	size_t pump(size_t maxBytes = SIZE_MAX)
+	{
+		return pump(maxBytes, nullptr, 0);
+	}
+
+	/**
+	 * @brief Process input queued in the ring buffer until a deadline passes
+	 * @param clock Returns the current time, e.g. micros
+	 * @param deadline Time to stop, checked after every pumpBlockSize bytes
+	 * @retval size_t Number of bytes processed
+	 */
+	size_t pumpUntil(uint32_t (*clock)(), uint32_t deadline)
+	{
+		return pump(SIZE_MAX, clock, deadline);
+	}
+
+	static constexpr size_t pumpBlockSize = 64;
+
+	/**
+	 * @brief Keep a shadow copy of the screen so that only changed cells get drawn
+	 * @param enable
+	 * @retval bool false if the grid could not be allocated
+	 * @note With the grid enabled, output is drawn by flush(), which is called at the
+	 * end of putc(), puts(), nputs() and printf(). Enabling the grid clears the screen.
+	 */
+	bool enableCellGrid(bool enable);
+
+	bool isCellGridEnabled() const
+	{
+		return gridEnabled;
+	}
+
+	/**
+	 * @brief Draw any cells which have changed since the last flush
+	 */
+	void flush();
+
+	/**
+	 * @brief Keep lines which scroll off the top of the screen
+	 * @param size Buffer size in bytes, 0 to disable
+	 * @param allocator Optional, for placing the buffer in external memory
+	 * @retval bool false if the buffer could not be allocated
+	 * @note Requires the cell grid
+	 */
+	bool enableScrollback(size_t size, const Scrollback::Allocator* allocator = nullptr);
+
+	/**
+	 * @brief Move the view back into scrollback history (lines > 0) or towards the live screen (lines < 0)
+	 * @retval unsigned Number of history lines now shown at the top of the screen
+	 * @note Any new output returns the view to the live screen
+	 */
+	unsigned scrollView(int lines);
+
+	unsigned getViewOffset() const
+	{
+		return viewOffset;
+	}
+
+	const Scrollback& getScrollback() const
+	{
+		return scrollback;
+	}
+
+	/**
+	 * @brief Only update the cell grid when processing output, drawing changes in present()
+	 * @param maxFrameRate Maximum frames per second, 0 to draw immediately (the default)
+	 * @retval bool false if the cell grid could not be enabled
+	 * @note Bursts of output then only cost one redraw of the final state per frame
+	 */
+	bool enableFramePacing(unsigned maxFrameRate);
+
+	bool isFramePaced() const
+	{
+		return frameInterval != 0;
+	}
+
+	/**
+	 * @brief Determine if there are changes waiting to be drawn
+	 */
+	bool isFramePending() const;
+
+	/**
+	 * @brief Get time at which present() will next draw, if a frame is pending
+	 */
+	uint32_t getNextFrameTime() const
+	{
+		return lastFrameTime + frameInterval;
+	}
+
+	/**
+	 * @brief Draw pending changes if a frame is due
+	 * @param now Current time in milliseconds, e.g. from millis()
+	 * @retval bool true if a frame was drawn
+	 */
+	bool present(uint32_t now);
 
 	uint16_t width() const
 	{
@@ -83,32 +231,121 @@ public:
 		return colCount;
 	}
 
+	/**
+	 * @brief Save cursor, modes, parser state and screen content
+	 * @param buffer Where to write the snapshot, nullptr to just get the size required
+	 * @param size Size of buffer
+	 * @param base Optional full snapshot to store only the cells which differ from
+	 * @param baseSize
+	 * @retval size_t Size of snapshot, 0 if the cell grid isn't enabled or base is invalid.
+	 * If greater than `size` the snapshot was truncated and must be discarded.
+	 * @note Requires the cell grid. Scrollback is not included.
+	 */
+	size_t saveState(uint8_t* buffer, size_t size, const uint8_t* base = nullptr, size_t baseSize = 0) const;
+
+	/**
+	 * @brief Restore state from a snapshot, then redraw the screen
+	 * @param data Snapshot from saveState()
+	 * @param size
+	 * @param base For a delta snapshot, the snapshot it was made against
+	 * @param baseSize
+	 * @retval bool false if the snapshot is corrupt, the base doesn't match or the screen size differs.
+	 * The terminal is unchanged unless an inconsistency is found part way through, when it is reset.
+	 */
+	bool restoreState(const uint8_t* data, size_t size, const uint8_t* base = nullptr, size_t baseSize = 0);
+
+	/**
+	 * @brief Generate the escape sequences which reproduce the screen, cursor and modes on another terminal
+	 * @param buffer Where to write, nullptr to just get the size required
+	 * @param size Size of buffer
+	 * @param base Optional snapshot from saveState() of what the other terminal already shows,
+	 * so only the differences are sent
+	 * @param baseSize
+	 * @retval size_t Length of output, 0 if the cell grid isn't enabled or base is invalid.
+	 * If greater than `size` the output was truncated and must be discarded.
+	 * @note The grid holds font codes rather than Unicode, so anything outside printable ASCII is sent as '?'
+	 */
+	size_t getRepaint(char* buffer, size_t size, const uint8_t* base = nullptr, size_t baseSize = 0) const;
+
+#if VT100_ENABLE_STATS
+	/**
+	 * @brief Get a copy of the counters accumulated since the last resetStats()
+	 */
+	Stats getStats() const
+	{
+		return stats;
+	}
+
+	void resetStats()
+	{
+		stats = {};
+	}
+#endif
+
 protected:
-	enum class State {
-#define XX(s) s,
-		VT100_STATE_MAP(XX)
-#undef XX
-	};
+	/**
+	 * @brief Use a fixed screen size rather than working it out from the display
+	 * @param cols, rows
+	 * @param cells, dirty Caller-owned storage for the cell grid, nullptr to allocate it when enabled
+	 */
+	void setFixedSize(uint16_t cols, uint16_t rows, Cell* cells, CellGrid::Span* dirty);
 
 	void resetScroll();
 	void clearLines(uint16_t start_line, uint16_t end_line);
 	void move(int16_t right_left, int16_t bottom_top);
 	void drawCursor();
 	void putcInternal(uint8_t ch);
+	void parseText(const char* str, size_t length);
+	size_t pump(size_t maxBytes, uint32_t (*clock)(), uint32_t deadline);
+	void print(uint8_t ch);
+	void putCodepoint(uint32_t codepoint);
+	void putWide(uint8_t ch);
+	void splitWide(uint16_t row, uint16_t col, uint16_t endCol);
+	unsigned getTextRun(const char* str, const char* end) const;
+	void putRun(const char* str, unsigned length);
+	void initGrid();
+	unsigned getBlankRun(uint16_t row, uint16_t col, uint16_t endCol);
+	void drawCells(uint16_t row, uint16_t col, uint16_t endCol, uint16_t screenRow);
+	void scrollRegion(uint16_t top, uint16_t bottom, int lines);
+	void applyScroll();
+	void shiftChars(int count);
+	void saveLines(uint16_t count);
+	void resetView();
+	void drawViewRow(uint16_t row);
+	void drawUnderline(uint16_t col, uint16_t row, uint16_t count, uint16_t color);
+	void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+	void setStyle(const Style& newStyle);
+	Attr getStyleId(const Style& style);
+	void collectStyles();
+	uint8_t getCharId(uint32_t codepoint);
+	void collectChars();
 
-#define XX(s) void state_##s(uint8_t ev, uint16_t arg);
-	VT100_STATE_MAP(XX)
-#undef XX
-
-	void callState(uint8_t ev, uint16_t arg)
+	// feed one byte through the parser state machine
+	void parse(uint8_t ch)
 	{
-		(this->*stateTable[unsigned(state)])(ev, arg);
+		VT100_STATS(++stats.stateBytes[unsigned(state)]);
+		auto entry = Parser::transitions[unsigned(state)][Parser::byteClasses[ch]];
+		auto next = Parser::getNextState(entry);
+		if(next == Parser::stateUnchanged) {
+			performAction(Parser::getAction(entry), ch);
+			return;
+		}
+		performAction(Parser::exitActions[unsigned(state)], ch);
+		performAction(Parser::getAction(entry), ch);
+		state = State(next);
+		VT100_STATS(countEntry(state));
+		performAction(Parser::entryActions[next], ch);
 	}
 
-private:
-	using StateMethod = void (Terminal::*)(uint8_t ev, uint16_t arg);
-	static const StateMethod stateTable[];
+	void performAction(Action action, uint8_t ch);
+	void execute(uint8_t ch);
+	void escDispatch(uint8_t ch);
+	void csiDispatch(uint8_t ch);
+#if VT100_ENABLE_STATS
+	void countEntry(State newState);
+#endif
 
+private:
 	union Flags {
 		uint8_t val;
 		struct {
@@ -135,34 +372,97 @@ private:
 	uint16_t screenWidth;
 	uint16_t screenHeight;
 	// Screen size in characters
-	uint16_t rowCount, colCount;
-	// colors used for rendering current characters
-	uint16_t backColor;
-	uint16_t frontColor;
+	uint16_t rowCount{0}, colCount{0};
+	// Set by setFixedSize(), otherwise 0
+	uint16_t fixedRowCount{0}, fixedColCount{0};
+	// attributes used for rendering current characters
+	Style style;
+	// ID of current style when using cell grid
+	Attr attr;
 	//
 	uint8_t charWidth;
 	uint8_t charHeight;
 
-	// command arguments that get parsed as they appear in the terminal
+	// command arguments and intermediate characters that get parsed as they appear in the terminal
 	struct Args {
-		uint16_t values[4];
+		static constexpr unsigned maxCount = 16;
+		static constexpr unsigned maxIntermediates = 2;
+
+		uint16_t values[maxCount];
 		uint8_t count;
+		char intermediates[maxIntermediates];
+		uint8_t intermediateCount;
+		bool overflow;
+
+		void add(char c)
+		{
+			if(count == 0) {
+				count = 1;
+			}
+			if(c == ';') {
+				if(count < maxCount) {
+					++count;
+				} else {
+					overflow = true;
+				}
+				return;
+			}
+			if(overflow) {
+				return;
+			}
+			// saturate rather than wrap, so a huge count still means "as far as possible"
+			auto& value = values[count - 1];
+			value = std::min(value * 10U + unsigned(c - '0'), 0xffffU);
+		}
 
-		void addDigit(char c)
+		void collect(char c)
 		{
-			values[count] *= 10;
-			values[count] += c - '0';
+			if(intermediateCount < maxIntermediates) {
+				intermediates[intermediateCount++] = c;
+			}
 		}
 
 		uint16_t operator[](unsigned index) const
 		{
 			return values[index];
 		}
+
+		// get argument value, substituting default if missing or zero
+		uint16_t get(unsigned index, uint16_t defaultValue) const
+		{
+			return (index < count && values[index] != 0) ? values[index] : defaultValue;
+		}
+
+		char getIntermediate() const
+		{
+			return intermediateCount ? intermediates[0] : '\0';
+		}
 	};
 	Args args;
 
 	State state;
-	State ret_state;
+	Utf8Decoder utf8;
+
+	CellGrid grid;
+	StyleTable styles;
+	CharTable chars;
+	Scrollback scrollback;
+	InputRing input;
+	uint16_t viewOffset{0};
+	// Scrolling done in the grid but not yet on the display
+	struct PendingScroll {
+		uint16_t top;
+		uint16_t bottom;
+		int16_t lines;
+	};
+	PendingScroll pendingScroll{};
+	// Frame pacing (milliseconds)
+	uint16_t frameInterval{0};
+	uint32_t lastFrameTime{0};
+	bool gridEnabled{false};
+#if VT100_ENABLE_STATS
+	Stats stats{};
+#endif
 
 	Display& display;
 	Callbacks& callbacks;
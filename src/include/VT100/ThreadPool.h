@@ -0,0 +1,99 @@
+/**
+ * ThreadPool.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VT100
+{
+/**
+ * @brief Work-stealing thread pool
+ *
+ * Each worker has its own task queue. Tasks submitted from a worker go on its own queue,
+ * others are spread round-robin. An idle worker takes the newest task from its own queue,
+ * or failing that steals the oldest task from another worker. Tasks passed to defer() go to
+ * the other end of the queue, so run after everything already queued there.
+ *
+ * @note Host builds only
+ */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	/**
+	 * @param threadCount 0 for one per hardware thread
+	 */
+	explicit ThreadPool(unsigned threadCount = 0);
+
+	/**
+	 * @brief Run any remaining tasks then stop the workers
+	 */
+	~ThreadPool();
+
+	void submit(Task task)
+	{
+		push(std::move(task), false);
+	}
+
+	/**
+	 * @brief Queue a task behind any already waiting, e.g. to yield to them
+	 */
+	void defer(Task task)
+	{
+		push(std::move(task), true);
+	}
+
+	unsigned getThreadCount() const
+	{
+		return workers.size();
+	}
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	void push(Task task, bool deferred);
+	void run(unsigned index);
+	bool pop(unsigned index, Task& task);
+	bool steal(unsigned thief, Task& task);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<unsigned> nextWorker{0};
+	// Tasks queued but not yet taken
+	std::atomic<unsigned> queued{0};
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping{false};
+};
+
+} // namespace VT100
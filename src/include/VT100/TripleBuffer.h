@@ -0,0 +1,82 @@
+/**
+ * TripleBuffer.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace VT100
+{
+/**
+ * @brief Lock-free hand-off of the latest value from one writer thread to one reader thread
+ *
+ * The writer fills in getWriteBuffer() then calls publish(). The reader calls read() to get the
+ * most recently published value, which stays valid until its next read(). Neither side ever waits,
+ * and intermediate values the reader doesn't get round to are skipped.
+ */
+template <typename T> class TripleBuffer
+{
+public:
+	T& getWriteBuffer()
+	{
+		return buffers[back];
+	}
+
+	void publish()
+	{
+		back = middle.exchange(back | fresh, std::memory_order_acq_rel) & indexMask;
+	}
+
+	/**
+	 * @brief Get the latest published value
+	 * @retval const T* nullptr if nothing has been published yet
+	 */
+	const T* read()
+	{
+		if(middle.load(std::memory_order_relaxed) & fresh) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+			valid = true;
+		}
+		return valid ? &buffers[front] : nullptr;
+	}
+
+	// Determine if read() would return a newer value
+	bool isFresh() const
+	{
+		return middle.load(std::memory_order_relaxed) & fresh;
+	}
+
+private:
+	static constexpr uint8_t indexMask = 0x03;
+	static constexpr uint8_t fresh = 0x04;
+
+	T buffers[3];
+	// Index of the buffer between writer and reader, plus `fresh` if it's newer than the reader's
+	std::atomic<uint8_t> middle{1};
+	// Owned by the writer
+	uint8_t back{0};
+	// Owned by the reader
+	uint8_t front{2};
+	bool valid{false};
+};
+
+} // namespace VT100
@@ -0,0 +1,185 @@
+/**
+ * Unicode.h
+ *
+	This file is part of FORTMAX kernel.
+
+	FORTMAX kernel is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	FORTMAX kernel is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with FORTMAX kernel.  If not, see <http://www.gnu.org/licenses/>.
+
+	@author 2019 mikee47 <mike@sillyhouse.net>
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#ifndef VT100_MAX_CHARS
+#define VT100_MAX_CHARS 128
+#endif
+
+namespace VT100
+{
+/**
+ * @brief Incremental UTF-8 decoder, fed one byte at a time
+ */
+class Utf8Decoder
+{
+public:
+	// More bytes are needed to complete the character
+	static constexpr uint32_t pending = 0xffffffff;
+	// The byte doesn't continue the current sequence; handle the sequence as malformed then decode the byte again
+	static constexpr uint32_t interrupted = 0xfffffffe;
+	// U+FFFD, returned for malformed sequences
+	static constexpr uint32_t replacement = 0xfffd;
+
+	/**
+	 * @brief Decode the next byte
+	 * @retval uint32_t Codepoint, `replacement`, `pending` or `interrupted`
+	 */
+	uint32_t decode(uint8_t c);
+
+	bool isPending() const
+	{
+		return remaining != 0;
+	}
+
+	void reset()
+	{
+		remaining = 0;
+	}
+
+	// Decoder state, for saving and restoring
+	struct SavedState {
+		uint32_t codepoint;
+		uint8_t remaining;
+		uint8_t length;
+	};
+
+	SavedState save() const
+	{
+		return SavedState{codepoint, remaining, length};
+	}
+
+	/**
+	 * @retval bool false if state is invalid
+	 */
+	bool restore(const SavedState& state)
+	{
+		if(state.length > 4 || (state.remaining != 0 && state.remaining >= state.length)) {
+			return false;
+		}
+		codepoint = state.codepoint;
+		remaining = state.remaining;
+		length = state.length;
+		return true;
+	}
+
+private:
+	uint32_t codepoint{0};
+	uint8_t remaining{0};
+	uint8_t length{0};
+};
+
+/**
+ * @brief Get number of cells a codepoint occupies
+ * @retval unsigned 2 for wide East Asian characters and emoji, 0 for combining marks and other
+ * zero-width characters, otherwise 1
+ */
+unsigned getCodepointWidth(uint32_t codepoint);
+
+/**
+ * @brief Encode a codepoint as UTF-8
+ * @param buffer At least 4 bytes
+ * @retval unsigned Number of bytes written
+ */
+unsigned encodeUtf8(uint32_t codepoint, char* buffer);
+
+/**
+ * @brief Interned set of non-ASCII characters, so character cells need only store a one-byte ID
+ *
+ * Cells hold ASCII as it is and characters from the table as `firstId` upwards. Each entry keeps
+ * the codepoint, so it can be sent on again, and the font glyph the display draws for it.
+ * `firstId` is always the replacement character U+FFFD.
+ */
+class CharTable
+{
+public:
+	static constexpr unsigned maxChars = VT100_MAX_CHARS;
+	static constexpr uint8_t firstId = 0x80;
+	// Not a character ID, as that's a wide character continuation in a cell
+	static constexpr uint8_t invalid = 0;
+	static_assert(maxChars >= 1 && maxChars <= 128, "VT100_MAX_CHARS out of range");
+
+	CharTable()
+	{
+		reset('?');
+	}
+
+	/**
+	 * @brief Remove everything except the replacement character
+	 * @param replacementGlyph What the display draws for U+FFFD
+	 */
+	void reset(uint8_t replacementGlyph);
+
+	/**
+	 * @brief Find or add a character
+	 * @retval uint8_t ID, or `invalid` if the table is full
+	 */
+	uint8_t intern(uint32_t codepoint, uint8_t glyph);
+
+	static bool isId(uint8_t ch)
+	{
+		return ch >= firstId && ch < firstId + maxChars;
+	}
+
+	// Codepoint for the content of a cell
+	uint32_t getCodepoint(uint8_t ch) const
+	{
+		return isId(ch) ? codepoints[ch - firstId] : ch;
+	}
+
+	// Font glyph to draw for the content of a cell
+	uint8_t getGlyph(uint8_t ch) const
+	{
+		return isId(ch) ? glyphs[ch - firstId] : ch;
+	}
+
+	/**
+	 * @brief Release all characters not marked as used
+	 * @param used Bitmap with one bit per ID
+	 */
+	void collect(const uint32_t* used);
+
+	static constexpr unsigned bitmapWords = (maxChars + 31) / 32;
+
+	static void mark(uint32_t* bitmap, uint8_t ch)
+	{
+		if(isId(ch)) {
+			unsigned i = ch - firstId;
+			bitmap[i / 32] |= 1U << (i % 32);
+		}
+	}
+
+	static bool isMarked(const uint32_t* bitmap, uint8_t ch)
+	{
+		unsigned i = ch - firstId;
+		return isId(ch) && (bitmap[i / 32] & (1U << (i % 32)));
+	}
+
+private:
+	uint32_t codepoints[maxChars];
+	uint8_t glyphs[maxChars];
+	uint32_t allocated[bitmapWords];
+};
+
+} // namespace VT100